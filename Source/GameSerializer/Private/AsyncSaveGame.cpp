@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AsyncSaveGame.h"
+
+#include "Classes.h"
+#include "SerializationHelpers.h"
+
+UAsyncSaveGameToSlot* UAsyncSaveGameToSlot::AsyncSaveGameToSlot( UObject* WorldContextObject, int32 Slot )
+{
+	UAsyncSaveGameToSlot* action = NewObject< UAsyncSaveGameToSlot >();
+	action->WorldContext = WorldContextObject;
+	action->Slot = Slot;
+	action->RegisterWithGameInstance( WorldContextObject );
+
+	return action;
+}
+
+void UAsyncSaveGameToSlot::Activate()
+{
+	UGameSaveManager* manager = WorldContext ? USerializationHelpers::GetGameSaveManager( WorldContext ) : nullptr;
+
+	if ( !manager )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Async save requested without a save manager!" ) );
+		HandleSaveComplete( nullptr, false );
+		return;
+	}
+
+	manager->SaveGameToSlotAsync( Slot, FGameSaveCompleteDelegate::CreateUObject( this, &UAsyncSaveGameToSlot::HandleSaveComplete ) );
+}
+
+void UAsyncSaveGameToSlot::HandleSaveComplete( USavedGameState* save, bool bSuccess )
+{
+	if ( bSuccess )
+	{
+		Completed.Broadcast( save, bSuccess );
+	}
+	else
+	{
+		Failed.Broadcast( save, bSuccess );
+	}
+
+	SetReadyToDestroy();
+}
@@ -4,6 +4,9 @@
 #include "SerializationHelpers.h"
 #include "SerializationManager.h"
 #include "GameSerializerSettings.h"
+#include "GameSaveContainer.h"
+#include "GameSaveJournal.h"
+#include "GameSerializerStats.h"
 
 #include "Engine/Engine.h"
 //#include "EngineGlobals.h"
@@ -11,6 +14,95 @@
 #include "GameFramework/GameModeBase.h"
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/PlayerState.h"
+#include "Async/Async.h"
+#include "UObject/GarbageCollection.h"
+#include "UObject/UObjectGlobals.h"
+#include "Misc/PackageName.h"
+#include "Streaming/LevelStreamingDelegates.h"
+#include "Engine/LevelStreaming.h"
+#include "HAL/IConsoleManager.h"
+
+namespace SaveLevels
+{
+	/** Level packages are keyed without the PIE prefix, so editor sessions and packaged games share ids. */
+	static FName GetPackageKey( const FString& packageName )
+	{
+		return FName( *UWorld::RemovePIEPrefix( packageName ) );
+	}
+}
+
+namespace SaveStats
+{
+	/** Classes listed in a capture summary, the rest is only counted. */
+	static const int32 MaxSummaryClasses = 10;
+
+	/** Logs the summary of a finished capture and publishes it to the stat system and the CSV profiler. */
+	static void RecordCapture( const FGameSerializerCaptureStats& stats, const TCHAR* description )
+	{
+		UE_LOG( LogSaveGame, Log, TEXT( "%s: %i actors serialized, %i reused, %lld bytes, %lld stored (%i actors share a blob, %.2fx dedup). Ignored %i: %i blacklisted, %i tagged Ignore, %i static, %i without the Save tag" ),
+			description, stats.ActorsSerialized, stats.ActorsReused, stats.Bytes, stats.ArenaBytes, stats.ActorsShared, stats.GetDedupRatio(),
+			stats.GetIgnoredCount(), stats.IgnoredBlacklisted, stats.IgnoredTagged, stats.IgnoredStatic, stats.IgnoredUntagged );
+
+		if ( UE_LOG_ACTIVE( LogSaveGame, Log ) )
+		{
+			TArray< TPair< FName, FGameSerializerClassCaptureStats > > classes = stats.Classes.Array();
+			classes.Sort( []( const TPair< FName, FGameSerializerClassCaptureStats >& a, const TPair< FName, FGameSerializerClassCaptureStats >& b ) { return a.Value.Bytes > b.Value.Bytes; } );
+
+			for ( int32 x = 0; x < classes.Num() && x < MaxSummaryClasses; x++ )
+			{
+				UE_LOG( LogSaveGame, Log, TEXT( "  %-40s %6i actors %10lld bytes" ), *classes[x].Key.ToString(), classes[x].Value.Actors, classes[x].Value.Bytes );
+			}
+
+			if ( classes.Num() > MaxSummaryClasses )
+			{
+				UE_LOG( LogSaveGame, Log, TEXT( "  and %i more classes" ), classes.Num() - MaxSummaryClasses );
+			}
+		}
+
+		SET_DWORD_STAT( STAT_GameSerializer_ActorsSerialized, stats.ActorsSerialized );
+		SET_DWORD_STAT( STAT_GameSerializer_ActorsReused, stats.ActorsReused );
+		SET_DWORD_STAT( STAT_GameSerializer_ActorsShared, stats.ActorsShared );
+		SET_FLOAT_STAT( STAT_GameSerializer_DedupRatio, stats.GetDedupRatio() );
+
+		CSV_CUSTOM_STAT( GameSerializer, ActorsSerialized, stats.ActorsSerialized, ECsvCustomStatOp::Set );
+		CSV_CUSTOM_STAT( GameSerializer, ActorsReused, stats.ActorsReused, ECsvCustomStatOp::Set );
+		CSV_CUSTOM_STAT( GameSerializer, ActorsShared, stats.ActorsShared, ECsvCustomStatOp::Set );
+		CSV_CUSTOM_STAT( GameSerializer, DedupRatio, (float)stats.GetDedupRatio(), ECsvCustomStatOp::Set );
+	}
+}
+
+namespace SavePersistentObjects
+{
+	/**
+	 * Puts an object's SaveGame properties back to their defaults, tagged blobs leave out values equal to the defaults.
+	 * Instanced properties are left alone, copying them would point the object at the class default's subobjects.
+	 */
+	static void ResetSaveGameProperties( UObject* object )
+	{
+		const UObject* defaults = object->GetClass()->GetDefaultObject();
+
+		for ( TFieldIterator< FProperty > it( object->GetClass() ); it; ++it )
+		{
+			if ( it->HasAnyPropertyFlags( CPF_SaveGame ) && !it->HasAnyPropertyFlags( CPF_InstancedReference | CPF_ContainsInstancedReference ) )
+			{
+				it->CopyCompleteValue_InContainer( object, defaults );
+			}
+		}
+	}
+
+	/** Moves an object that can't be reused out of the way of its replacement's name. */
+	static void Retire( UObject* object )
+	{
+		const FName staleName = MakeUniqueObjectName( GetTransientPackage(), object->GetClass(), TEXT( "StalePersistentObject" ) );
+		object->Rename( *staleName.ToString(), GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional | REN_DoNotDirty | REN_ForceNoResetLoaders );
+	}
+}
+
+namespace SaveSlots
+{
+	/** Slots are probed contiguously from 0, never past this many. */
+	static const int32 MaxSlots = 26;
+}
 
 Classes::Classes()
 {
@@ -20,11 +112,18 @@ Classes::~Classes()
 {
 }
 
+void USavedGameState::GetResourceSizeEx( FResourceSizeEx& CumulativeResourceSize )
+{
+	Super::GetResourceSizeEx( CumulativeResourceSize );
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes( GetAllocatedSize() );
+}
+
 UGameSaveManager::UGameSaveManager()
 {
 	CurrentGameState = FSerializedGameState();
 	CurrentSlot = 0;
 	bIsLoading = false;
+	InFlightSaveObject = nullptr;
 }
 
 void UGameSaveManager::CreateSessionSave()
@@ -35,7 +134,7 @@ void UGameSaveManager::CreateSessionSave()
 void UGameSaveManager::Initialize( FSubsystemCollectionBase & Collection )
 {
 	Super::Initialize( Collection );
-	UE_LOG( LogSaveGame, Warning, TEXT( "Game Save Manager initialized!" ) );
+	UE_LOG( LogSaveGame, Log, TEXT( "Game Save Manager initialized!" ) );
 
 	if(UGameSerializerSettings* Settings = UGameSerializerSettings::Get())
 	{
@@ -62,42 +161,238 @@ void UGameSaveManager::Initialize( FSubsystemCollectionBase & Collection )
 	//	}
 	//}
 
-	/*ActorLoadBinding = GEngine->OnLevelActorAdded().AddLambda( [this]( AActor* level ) {
-		LoadedActor( level );
-	} );
-	*/
+	// Keep the per-level actor registries current as actors come and go
+	ActorLoadBinding = FWorldDelegates::OnPostWorldInitialization.AddUObject( this, &UGameSaveManager::HandleWorldInitialized );
+	WorldCleanupBinding = FWorldDelegates::OnWorldCleanup.AddUObject( this, &UGameSaveManager::HandleWorldCleanup );
+	LevelStreamingBinding = FLevelStreamingDelegates::OnLevelStreamingStateChanged.AddUObject( this, &UGameSaveManager::HandleLevelStreamingStateChanged );
+
+	if ( UWorld* world = GetWorld() )
+	{
+		BindWorld( world );
+	}
 	//LoadGameFromSlot( 0 );
 }
 
 void UGameSaveManager::Deinitialize()
 {
-	//GEngine->OnLevelActorAdded().Remove( ActorLoadBinding );
+	FWorldDelegates::OnPostWorldInitialization.Remove( ActorLoadBinding );
+	FWorldDelegates::OnWorldCleanup.Remove( WorldCleanupBinding );
+	FLevelStreamingDelegates::OnLevelStreamingStateChanged.Remove( LevelStreamingBinding );
+
+	for ( auto&& keypair : WorldBindings )
+	{
+		if ( UWorld* world = keypair.Key.ResolveObjectPtr() )
+		{
+			world->RemoveOnActorSpawnedHandler( keypair.Value.Spawned );
+			world->RemoveOnActorDestroyededHandler( keypair.Value.Destroyed );
+		}
+	}
+
+	WorldBindings.Empty();
+	SerializationManagers.Empty();
+
+	// Nothing captured after this gets written, whoever waits on those saves hears they failed
+	for ( const FPendingSave& queued : QueuedSaves )
+	{
+		FailSave( queued, nullptr );
+	}
+
+	QueuedSaves.Empty();
+
+	// A write still on a worker is waited for, the slot would be left half written and its save object collected under it
+	if ( InFlightWrite.IsValid() )
+	{
+		const FSaveWriteResult result = InFlightWrite.Get();
+		FinishSaveWrite( InFlightSaveObject, result );
+	}
+	else if ( InFlightSave.IsSet() )
+	{
+		// Nothing left to capture from, the save is dropped
+		FailSave( InFlightSave.GetValue(), InFlightSaveObject );
+
+		InFlightSave.Reset();
+		InFlightSaveObject = nullptr;
+	}
+
+	bAmortizedCaptureRunning = false;
+	CapturingManagers.Empty();
+
+	// Prefetches still running find nothing to hand their result to
+	WorldPrefetches.Empty();
+
+	Super::Deinitialize();
+}
+
+void UGameSaveManager::HandleWorldInitialized( UWorld* world, const UWorld::InitializationValues values )
+{
+	BindWorld( world );
+}
+
+void UGameSaveManager::HandleWorldCleanup( UWorld* world, bool bSessionEnded, bool bCleanupResources )
+{
+	FWorldBindings bindings;
+
+	if ( world && WorldBindings.RemoveAndCopyValue( world, bindings ) )
+	{
+		world->RemoveOnActorSpawnedHandler( bindings.Spawned );
+		world->RemoveOnActorDestroyededHandler( bindings.Destroyed );
+	}
+}
+
+void UGameSaveManager::BindWorld( UWorld* world )
+{
+	if ( !world || world->GetGameInstance() != GetGameInstance() || WorldBindings.Contains( world ) )
+	{
+		return;
+	}
+
+	FWorldBindings& bindings = WorldBindings.Add( world );
+	bindings.Spawned = world->AddOnActorSpawnedHandler( FOnActorSpawned::FDelegate::CreateUObject( this, &UGameSaveManager::LoadedActor ) );
+	bindings.Destroyed = world->AddOnActorDestroyedHandler( FOnActorDestroyed::FDelegate::CreateUObject( this, &UGameSaveManager::UnloadedActor ) );
+}
+
+USavedGameState* UGameSaveManager::GetCurrentSave()
+{
+	const bool bHasSave = GetManifest().Find( CurrentSlot ) || ( SavedGames.IsValidIndex( CurrentSlot ) && SavedGames[CurrentSlot] );
+
+	if ( !bHasSave )
+	{
+		return nullptr;
+	}
+
+	return GetSaveAtSlot( CurrentSlot );
 }
 
 USavedGameState * UGameSaveManager::GetSaveAtSlot( int32 slot )
 {
-	TArray< USavedGameState* > saves = GetSaves();
+	LLM_SCOPE_BYTAG( GameSerializer_SaveFile );
+
+	GetSaves();
+
+	if ( !SavedGames.IsValidIndex( slot ) )
+	{
+		SavedGames.SetNum( slot + 1 );
+	}
+
+	USavedGameState*& save = SavedGames[slot];
+
+	// Opening a slot is the only time its payload is read
+	if ( save && save->bHeaderOnly )
+	{
+		if ( USavedGameState* loaded = FGameSaveContainer::LoadSave( GetIndexedSaveName( slot ), false ) )
+		{
+			save = loaded;
+		}
+		else
+		{
+			UE_LOG( LogSaveGame, Warning, TEXT( "Slot %i is in the manifest but couldn't be loaded" ), slot );
+			save->bHeaderOnly = false;
+		}
+	}
 
-	if ( saves.IsValidIndex( slot ) == false || saves[slot] == nullptr )
+	if ( save == nullptr )
 	{
-		saves.SetNum( slot + 1, false );
-		saves[slot] = CreateSaveGame();
+		save = CreateSaveGame();
 		UE_LOG( LogSaveGame, Warning, TEXT( "Had to create save for slot %i" ), slot );
 	}
 
-	return saves[slot];
+	return save;
 }
 
 FSerializedWorld UGameSaveManager::GetWorldState( FName Id, bool& success )
 {
-	if ( CurrentGameState.Worlds.Contains(Id) )
+	const FSerializedWorld* world = FindWorldState( Id );
+	success = world != nullptr;
+
+	return world ? *world : FSerializedWorld();
+}
+
+const FSerializedWorld* UGameSaveManager::FindWorldState( FName Id )
+{
+	LLM_SCOPE_BYTAG( GameSerializer_WorldState );
+
+	if ( const FSerializedWorld* world = CurrentGameState.Worlds.Find( Id ) )
+	{
+		return world;
+	}
+
+	for ( const ASerializationManager* manager : SerializationManagers )
+	{
+		if ( IsValid( manager ) && manager->WorldID == Id && manager->OwnsWorldState() )
+		{
+			return &manager->GetWorldData();
+		}
+	}
+
+	// Stays decoded next to its encoded copy, the two only part ways once the world changes
+	if ( const FEncodedWorldPtr* encoded = CurrentGameState.EncodedWorlds.Find( Id ) )
+	{
+		FSerializedWorld world;
+
+		if ( ConsumePrefetch( Id, world ) || FGameSaveContainer::DecodeWorld( **encoded, world ) )
+		{
+			return &CurrentGameState.Worlds.Add( Id, MoveTemp( world ) );
+		}
+
+		UE_LOG( LogSaveGame, Error, TEXT( "Couldn't decode world %s" ), *Id.ToString() );
+	}
+
+	return nullptr;
+}
+
+bool UGameSaveManager::HasWorldState( FName Id ) const
+{
+	if ( CurrentGameState.Worlds.Contains( Id ) || CurrentGameState.EncodedWorlds.Contains( Id ) )
+	{
+		return true;
+	}
+
+	return SerializationManagers.ContainsByPredicate( [Id]( const ASerializationManager* manager )
+	{
+		return IsValid( manager ) && manager->WorldID == Id && manager->OwnsWorldState();
+	} );
+}
+
+FSerializedWorld UGameSaveManager::TakeWorldState( FName Id )
+{
+	LLM_SCOPE_BYTAG( GameSerializer_WorldState );
+
+	FSerializedWorld world;
+
+	if ( FSerializedWorld* found = CurrentGameState.Worlds.Find( Id ) )
+	{
+		world = MoveTemp( *found );
+		CurrentGameState.Worlds.Remove( Id );
+	}
+	else if ( const FEncodedWorldPtr* encoded = CurrentGameState.EncodedWorlds.Find( Id ) )
+	{
+		// The encoded copy stays, CacheWorldState falls back to it if the level leaves without changing anything
+		if ( !ConsumePrefetch( Id, world ) && !FGameSaveContainer::DecodeWorld( **encoded, world ) )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Couldn't decode world %s" ), *Id.ToString() );
+			world = FSerializedWorld();
+		}
+	}
+
+	return world;
+}
+
+void UGameSaveManager::CacheWorldState( FName worldId, FSerializedWorld&& world, bool bDirty )
+{
+	LLM_SCOPE_BYTAG( GameSerializer_WorldState );
+
+	CurrentGameState.Worlds.Remove( worldId );
+	WorldPrefetches.Remove( worldId );
+
+	if ( !bDirty && CurrentGameState.EncodedWorlds.Contains( worldId ) )
 	{
-		success = true;
-		return CurrentGameState.Worlds[Id];
+		return;
 	}
 
-	success = false;
-	return FSerializedWorld();
+	TSharedRef< TArray< uint8 >, ESPMode::ThreadSafe > encoded = MakeShared< TArray< uint8 >, ESPMode::ThreadSafe >();
+	FGameSaveContainer::EncodeWorld( world, *encoded );
+
+	CurrentGameState.EncodedWorlds.Add( worldId, encoded );
 }
 
 USavedGameState * UGameSaveManager::StartNewGame( int32 slot )
@@ -107,15 +402,30 @@ USavedGameState * UGameSaveManager::StartNewGame( int32 slot )
 		slot = GetSaves().Num();
 	}
 
+	FlushInFlightSave();
+
 	CurrentSlot = slot;
 	USavedGameState* save = CreateSaveGame();
 
-	SavedGames.Add( save );
+	if ( !SavedGames.IsValidIndex( slot ) )
+	{
+		SavedGames.SetNum( slot + 1 );
+	}
+
+	SavedGames[slot] = save;
 
 	PersistentObjects.Empty();
 	CurrentGameState = FSerializedGameState();
 
-	UGameplayStatics::SaveGameToSlot( save, GetIndexedSaveName(slot), 0 );
+	// The slot starts over without a journal, whatever we knew about its old one is wrong now
+	Journals.Remove( GetIndexedSaveName( slot ) );
+
+	FGameSaveSlotInfo fileInfo;
+
+	if ( WriteSaveToSlot( save, GetIndexedSaveName( slot ), &fileInfo ) )
+	{
+		UpdateManifest( slot, save, fileInfo );
+	}
 	
 	//Use this to hook into the logic for handling new game things, like setting up mode, extra data, and loading initial map.
 	OnNewGame.Broadcast( save );
@@ -125,7 +435,15 @@ USavedGameState * UGameSaveManager::StartNewGame( int32 slot )
 
 void UGameSaveManager::LoadGameFromSlot( int32 index, bool bLoadLevel )
 {
-	USavedGameState* saveFile = Cast< USavedGameState >( UGameplayStatics::LoadGameFromSlot( GetIndexedSaveName( index ), 0 ) );
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_LoadSave );
+	LLM_SCOPE_BYTAG( GameSerializer_SaveFile );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "LoadGameFromSlot %i" ), index );
+
+	// A save still capturing or writing would swap world states under the load, or put its slot back over the loaded one
+	FlushInFlightSave();
+
+	// Worlds stay encoded until their level comes into play
+	USavedGameState* saveFile = FGameSaveContainer::LoadSave( GetIndexedSaveName( index ), false );
 
 	if ( !saveFile )
 	{
@@ -134,211 +452,954 @@ void UGameSaveManager::LoadGameFromSlot( int32 index, bool bLoadLevel )
 
 	CurrentSlot = index;
 
+	if ( !SavedGames.IsValidIndex( index ) )
+	{
+		SavedGames.SetNum( index + 1 );
+	}
+
+	SavedGames[index] = saveFile;
+
 	if ( bLoadLevel )
 	{
 		UGameplayStatics::OpenLevel( this, *saveFile->SavedMap, true );
 	}
 
-	LoadWorldState( saveFile->SavedState );
+	// The save object only held the state long enough to hand it over
+	LoadWorldState( MoveTemp( saveFile->SavedState ), !bLoadLevel );
+	saveFile->SavedState = FSerializedGameState();
 	OnLoad.Broadcast( saveFile );
 
-	UE_LOG( LogSaveGame, Warning, TEXT( "Loaded game!" ) );
+	UE_LOG( LogSaveGame, Log, TEXT( "Loaded game!" ) );
+}
+
+void UGameSaveManager::SaveSessionToSaveObject(USavedGameState* saveFile, bool bCaptureWorlds)
+{
+	LLM_SCOPE_BYTAG( GameSerializer_Capture );
+
+	if ( bCaptureWorlds )
+	{
+		CacheWorld();
+	}
+	else
+	{
+		CachePersistentState();
+	}
+
+	CaptureSessionHeader( saveFile );
+	CaptureWorldStates( saveFile );
+
+	OnSave.Broadcast( saveFile );
 }
 
-void UGameSaveManager::SaveSessionToSaveObject(USavedGameState* saveFile)
+void UGameSaveManager::CaptureSessionHeader( USavedGameState* saveFile )
 {
-	saveFile->SavedState = CacheWorld();
+	// These copies are the writer's snapshot, the game keeps changing the live state while it's written
+	saveFile->SavedState.PersistentObjects = CurrentGameState.PersistentObjects;
+	saveFile->SavedState.SavedPlayerState = CurrentGameState.SavedPlayerState;
+	saveFile->SavedState.References = CurrentGameState.References;
+
 	saveFile->SavedMap = UGameplayStatics::GetCurrentLevelName( this, true );
 
 	FDateTime time = FDateTime::Now();
+	saveFile->TimeOfSave = time;
 	saveFile->SavedTime = time.ToString();
+	saveFile->bHeaderOnly = false;
 
-	saveFile->SavedGameOptions = GetWorld()->GetAuthGameMode()->OptionsString;
+	// Worlds without a game mode (commandlets, tooling) have no options to save
+	if ( AGameModeBase* gameMode = GetWorld()->GetAuthGameMode() )
+	{
+		saveFile->SavedGameOptions = gameMode->OptionsString;
+	}
 	
 	if ( APawn* player = UGameplayStatics::GetPlayerPawn( this, 0 ) )
 	{
 		saveFile->PlayerTransform = player->GetActorTransform();
 	}
-
-	OnSave.Broadcast( saveFile );
 }
 
-void UGameSaveManager::SaveGameToSlot( int32 index )
+void UGameSaveManager::CaptureWorldStates( USavedGameState* saveFile )
 {
-	CurrentSlot = index;
-
-	// Load data from disk
-	USavedGameState* saveFile = GetSaveAtSlot( index ); //CreateSaveGame();//NewObject< USavedGameState >( GetTransientPackage() );
-
-	// Write data to object
-	SaveSessionToSaveObject(saveFile);
-
-	// Write data to disk
-	if ( UGameplayStatics::SaveGameToSlot( saveFile, GetIndexedSaveName(index), 0 ) )
+	FSerializedGameState& state = saveFile->SavedState;
+	state.EncodedWorlds = CurrentGameState.EncodedWorlds;
+	state.LevelWorldIds = CurrentGameState.LevelWorldIds;
+	state.Worlds.Reset();
+	state.SharedWorlds.Reset();
+
+	// A world FindWorldState decoded is the same as its encoded copy, the snapshot only needs the shared buffer
+	for ( auto&& keypair : CurrentGameState.Worlds )
 	{
-		auto size = (float)sizeof( saveFile );
-		UE_LOG( LogSaveGame, Warning, TEXT( "Saved game to %i! File size: %f" ), index, size );
+		if ( !CurrentGameState.EncodedWorlds.Contains( keypair.Key ) )
+		{
+			state.Worlds.Add( keypair.Key, keypair.Value );
+		}
 	}
-	else
+
+	for ( ASerializationManager* manager : SerializationManagers )
 	{
-		UE_LOG( LogSaveGame, Error, TEXT( "Failed to save game!" ) );
+		if ( IsValid( manager ) && manager->OwnsWorldState() )
+		{
+			state.SharedWorlds.Add( manager->WorldID, manager->ShareWorldState() );
+		}
 	}
 }
 
-TArray<USavedGameState*> UGameSaveManager::GetSaves()
+void UGameSaveManager::SaveGameToSlot( int32 index )
 {
-	//FString pref = "save_";
-	int32 index = 0;
+	SaveGameToSlotAsync( index );
+}
 
-	TArray< USavedGameState* > saves = TArray< USavedGameState* >();
+void UGameSaveManager::SaveGameToSlotAmortized( int32 index )
+{
+	SaveGameToSlotAsync( index, FGameSaveCompleteDelegate(), true );
+}
 
-	//If we already have saves, just return the array
-	if ( saves.Num() > 0 )
-	{
-		return SavedGames;
-	}
+TFuture< bool > UGameSaveManager::SaveGameToSlotAsync( int32 index, FGameSaveCompleteDelegate onComplete, bool bAmortizeCapture )
+{
+	check( IsInGameThread() );
 
-	while ( index <= 25 )
+	TSharedRef< TPromise< bool > > promise = MakeShared< TPromise< bool > >();
+	TFuture< bool > future = promise->GetFuture();
+
+	// A write is already running, fold this request into the queued one for the same slot
+	if ( InFlightSave.IsSet() )
 	{
-		FString slot = GetIndexedSaveName(index);//pref + FString::FromInt( index );
-		USavedGameState* save = Cast< USavedGameState >( UGameplayStatics::LoadGameFromSlot( slot, 0 ) );
+		FPendingSave* queued = QueuedSaves.FindByPredicate( [index]( const FPendingSave& pending ) { return pending.Slot == index; } );
 
-		if ( save )
+		if ( !queued )
 		{
-			saves.Add( save );
-			index++;
+			queued = &QueuedSaves.AddDefaulted_GetRef();
+			queued->Slot = index;
+			queued->bAmortizeCapture = bAmortizeCapture;
 		}
 		else
 		{
-			UE_LOG( LogSaveGame, Warning, TEXT( "Couldn't find save {%s}" ), *slot );
-			break;
+			// Anyone asking for an immediate capture wins
+			queued->bAmortizeCapture &= bAmortizeCapture;
+			UE_LOG( LogSaveGame, Log, TEXT( "Coalesced save request for slot %i" ), index );
 		}
+
+		queued->Callbacks.Add( onComplete );
+		queued->Promises.Add( promise );
+		return future;
 	}
 
-	SavedGames = saves;
+	FPendingSave request;
+	request.Slot = index;
+	request.bAmortizeCapture = bAmortizeCapture;
+	request.Callbacks.Add( onComplete );
+	request.Promises.Add( promise );
+
+	StartSaveWrite( MoveTemp( request ) );
 
-	return saves;
+	return future;
 }
 
-void UGameSaveManager::SaveSessionState()
+void UGameSaveManager::StartSaveWrite( FPendingSave&& request )
 {
-	check(IsValid(CurrentSessionSave));
+	CurrentSlot = request.Slot;
 
-	SaveSessionToSaveObject(CurrentSessionSave);
+	// The slot's current save stays in SavedGames until this one is on disk, a failed write leaves it untouched
+	USavedGameState* saveFile = CreateSaveGame();
 
-	UE_LOG(LogSaveGame, Verbose, TEXT("Saved current session!"));
-}
+	const bool bAmortize = request.bAmortizeCapture;
+	InFlightSave = MoveTemp( request );
+	InFlightSaveObject = saveFile;
 
-FString UGameSaveManager::GetIndexedSaveName(int32 index) const
-{
-	return SavePrefix + "save_" + FString::FromInt( index );
-}
+	if ( bAmortize )
+	{
+		// Every world starts its capture this frame, the actors get serialized over the next ones.
+		// Everything outside the worlds is captured right away, as it is at the start of the capture.
+		CachePersistentState();
+		CaptureSessionHeader( saveFile );
 
-void UGameSaveManager::AssignSavePrefix(FString Prefix)
-{
-	UE_LOG(LogSaveGame, Log, TEXT("Changed save manager prefix to %s"), *Prefix);
-	SavePrefix = Prefix;
-}
+		CapturingManagers.Reset();
+		LastCaptureStats = FGameSerializerCaptureStats();
 
-USavedGameState * UGameSaveManager::CreateSaveGame(FName NameOverride)
-{
-	TSubclassOf< USavedGameState > saveClass = USavedGameState::StaticClass();
-	UGameSerializerSettings* settings = GetMutableDefault< UGameSerializerSettings >();
+		for ( ASerializationManager* manager : SerializationManagers )
+		{
+			if ( IsValid( manager ) && manager->OwnsWorldState() )
+			{
+				manager->BeginCapture();
+				CapturingManagers.Add( manager );
+			}
+		}
 
-	if ( settings && settings->SaveClass )
-	{
-		saveClass = settings->SaveClass;
+		bAmortizedCaptureRunning = true;
+		return;
 	}
 
-	
-	return NewObject< USavedGameState >( this, saveClass, NameOverride );
+	// Snapshot the world into the save object, this is the only part that has to happen on the game thread
+	SaveSessionToSaveObject( saveFile );
+
+	WriteCapturedSave( saveFile );
 }
 
-void UGameSaveManager::LoadWorldState( FSerializedGameState state )
+void UGameSaveManager::Tick( float DeltaTime )
 {
-	CurrentGameState = state;
-
-	LoadPersistentObjects( state );
-
-	for ( TActorIterator< ASerializationManager > Iter( GetWorld() ); Iter; ++Iter )
+	if ( !bAmortizedCaptureRunning )
 	{
-		ASerializationManager* manager = *Iter;
+		return;
 	}
 
-	UE_LOG( LogSaveGame, Warning, TEXT( "Loaded world state!" ) );
-}
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	const double budget = settings ? settings->CaptureBudgetMs / 1000.0 : 0.0;
+	const double deadline = FPlatformTime::Seconds() + budget;
 
-void UGameSaveManager::LoadPersistentObjects( FSerializedGameState state )
-{
-	UE_LOG(LogTemp, Log, TEXT("Purging persistent objects and clearing garbage..."))
-	PersistentObjects.Empty();
-	GEngine->ForceGarbageCollection(true);
-	UE_LOG(LogTemp, Log, TEXT("Garbage purged!"))
-	
-	for ( auto&& keypair : CurrentGameState.PersistentObjects )
+	while ( CapturingManagers.Num() > 0 )
 	{
-		if ( keypair.Key == NAME_None )
+		ASerializationManager* manager = CapturingManagers[0].Get();
+
+		// Managers that left play already finished their capture in EndPlay
+		if ( manager && manager->IsCapturing() )
 		{
-			UE_LOG( LogSaveGame, Warning, TEXT( "Invalid name on persistent object save!" ) );
-			continue;
-		}
+			const double remaining = deadline - FPlatformTime::Seconds();
+
+			if ( budget > 0.0 && remaining <= 0.0 )
+			{
+				break;
+			}
 
-		UObject* object = FindObject<UObject>( GetTransientPackage(), *keypair.Key.ToString(), false );
+			if ( !manager->StepCapture( budget > 0.0 ? remaining : 0.0 ) )
+			{
+				break;
+			}
+
+			manager->FinishCapture();
+		}
 
-		if ( !object && keypair.Value.ObjectClass )
+		if ( manager )
 		{
-			object = NewObject< UObject >( GetTransientPackage(), keypair.Value.ObjectClass, keypair.Value.UniqueId );
-			UE_LOG( LogSaveGame, Warning, TEXT( "Created %s" ), *object->GetPathName() );
+			LastCaptureStats += manager->LastCaptureStats;
 		}
 
-		PersistentObjects.Add( object );
+		CapturingManagers.RemoveAt( 0 );
 	}
 
-	for ( int32 x = 0; x < PersistentObjects.Num(); x++ )
+	if ( CapturingManagers.Num() == 0 )
 	{
-		USerializationHelpers::LoadObject( PersistentObjects[x], CurrentGameState.PersistentObjects.FindOrAdd( *PersistentObjects[x]->GetPathName() ) );
+		FinishAmortizedCapture();
 	}
+}
 
-	UE_LOG( LogSaveGame, Warning, TEXT( "Loaded persistent objects!" ) );
+ETickableTickType UGameSaveManager::GetTickableTickType() const
+{
+	return HasAnyFlags( RF_ClassDefaultObject ) ? ETickableTickType::Never : ETickableTickType::Conditional;
 }
 
-FSerializedGameState UGameSaveManager::CacheWorld()
+void UGameSaveManager::FinishAmortizedCapture()
 {
-	GatherWorldStates();
+	bAmortizedCaptureRunning = false;
 
-	for ( UObject* obj : PersistentObjects )
-	{
-		FName saveId = USerializationHelpers::ResolveID( obj );
-		FSerializedGameObject saveObj = USerializationHelpers::SaveObject( obj );
+	SaveStats::RecordCapture( LastCaptureStats, TEXT( "Captured world over several frames" ) );
 
-		CurrentGameState.PersistentObjects.Add( saveId, saveObj );
-	}
+	CaptureWorldStates( InFlightSaveObject );
+	OnSave.Broadcast( InFlightSaveObject );
 
-	APlayerController* controller = UGameplayStatics::GetPlayerController( this, 0 );
+	WriteCapturedSave( InFlightSaveObject );
+}
+
+bool UGameSaveManager::IsRestoringWorlds() const
+{
+	return SerializationManagers.ContainsByPredicate( []( const ASerializationManager* manager ) { return IsValid( manager ) && manager->IsRestoring(); } );
+}
 
-	if ( APlayerState* state = controller->GetPlayerState< APlayerState >() )
+void UGameSaveManager::PreModifyActor( AActor* actor )
+{
+	if ( !bAmortizedCaptureRunning || !actor )
 	{
-		CurrentGameState.SavedPlayerState = USerializationHelpers::SaveActor( state );
+		return;
 	}
 
-	return CurrentGameState;
+	if ( ASerializationManager* manager = FindSerializationManager( actor->GetLevel() ) )
+	{
+		manager->CaptureActorNow( actor );
+	}
 }
 
-void UGameSaveManager::GatherWorldStates()
+void UGameSaveManager::WriteCapturedSave( USavedGameState* saveFile )
 {
-	TMap< UObject*, FName > worldPaths;
-	TArray< TSubclassOf< AActor > > typeBlacklist;
+	const FString slotName = GetIndexedSaveName( InFlightSave->Slot );
 
-	//Maybe cache serialization managers as they spawn?
-	for ( TActorIterator< ASerializationManager > Iter( GetWorld() ); Iter; ++Iter )
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	// Only one save is written at a time, so a slot's journal never sees two writers.
+	// Journals are plain files next to the slot, platform save systems only get whole slots.
+	TSharedPtr< FGameSaveJournal, ESPMode::ThreadSafe > journal;
+
+	if ( settings && settings->bJournalSaves && FGameSaveContainer::IsSlotFileBacked() )
+	{
+		TSharedPtr< FGameSaveJournal, ESPMode::ThreadSafe >& found = Journals.FindOrAdd( slotName );
+
+		if ( !found.IsValid() )
+		{
+			found = MakeShared< FGameSaveJournal, ESPMode::ThreadSafe >( slotName );
+		}
+
+		journal = found;
+	}
+	else
+	{
+		Journals.Remove( slotName );
+	}
+
+	if ( !settings || !settings->bWriteSavesAsync )
+	{
+		FSaveWriteResult result;
+		result.bSuccess = WriteSaveToSlot( saveFile, slotName, &result.FileInfo, journal.Get() );
+		FinishSaveWrite( saveFile, result );
+		return;
+	}
+
+	TWeakObjectPtr< UGameSaveManager > weakThis = this;
+
+	// The manifest is only written on the game thread, once FinishSaveWrite knows the slot made it to disk
+	InFlightWrite = Async( EAsyncExecution::ThreadPool, [weakThis, saveFile, slotName, journal]()
+	{
+		// saveFile is kept alive by InFlightSaveObject until FinishSaveWrite runs
+		FSaveWriteResult result;
+		result.bSuccess = WriteSaveToSlot( saveFile, slotName, &result.FileInfo, journal.Get() );
+
+		AsyncTask( ENamedThreads::GameThread, [weakThis, saveFile, result]()
+		{
+			if ( UGameSaveManager* manager = weakThis.Get() )
+			{
+				manager->FinishSaveWrite( saveFile, result );
+			}
+		} );
+
+		return result;
+	} );
+}
+
+void UGameSaveManager::FailSave( const FPendingSave& save, USavedGameState* saveFile )
+{
+	for ( const FGameSaveCompleteDelegate& callback : save.Callbacks )
+	{
+		callback.ExecuteIfBound( saveFile, false );
+	}
+
+	for ( const TSharedRef< TPromise< bool > >& promise : save.Promises )
+	{
+		promise->SetValue( false );
+	}
+
+	OnSaveComplete.Broadcast( saveFile, false );
+}
+
+void UGameSaveManager::FlushInFlightSave()
+{
+	// Whoever waits on a finished save can start another one right away, it gets flushed too
+	while ( InFlightSave.IsSet() )
+	{
+		for ( const FPendingSave& queued : QueuedSaves )
+		{
+			FailSave( queued, nullptr );
+		}
+
+		QueuedSaves.Empty();
+
+		if ( bAmortizedCaptureRunning )
+		{
+			// The rest of the capture happens this frame, while the worlds are still the ones it started from
+			for ( const TWeakObjectPtr< ASerializationManager >& weakManager : CapturingManagers )
+			{
+				ASerializationManager* manager = weakManager.Get();
+
+				if ( manager && manager->IsCapturing() )
+				{
+					manager->StepCapture( 0.0 );
+					manager->FinishCapture();
+				}
+
+				if ( manager )
+				{
+					LastCaptureStats += manager->LastCaptureStats;
+				}
+			}
+
+			CapturingManagers.Empty();
+			FinishAmortizedCapture();
+			continue;
+		}
+
+		if ( !InFlightWrite.IsValid() )
+		{
+			break;
+		}
+
+		const FSaveWriteResult result = InFlightWrite.Get();
+		FinishSaveWrite( InFlightSaveObject, result );
+	}
+}
+
+void UGameSaveManager::FinishSaveWrite( USavedGameState* saveFile, const FSaveWriteResult& result )
+{
+	check( IsInGameThread() );
+
+	// Already finished by Deinitialize
+	if ( !InFlightSave.IsSet() || saveFile != InFlightSaveObject )
+	{
+		return;
+	}
+
+	FPendingSave finished = MoveTemp( InFlightSave.GetValue() );
+	InFlightSave.Reset();
+	InFlightSaveObject = nullptr;
+	InFlightWrite = TFuture< FSaveWriteResult >();
+
+	if ( result.bSuccess )
+	{
+		if ( !SavedGames.IsValidIndex( finished.Slot ) )
+		{
+			SavedGames.SetNum( finished.Slot + 1 );
+		}
+
+		SavedGames[finished.Slot] = saveFile;
+		UpdateManifest( finished.Slot, saveFile, result.FileInfo );
+
+		UE_LOG( LogSaveGame, Log, TEXT( "Saved game to %i!" ), finished.Slot );
+	}
+	else
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Failed to save game!" ) );
+	}
+
+	for ( const FGameSaveCompleteDelegate& callback : finished.Callbacks )
+	{
+		callback.ExecuteIfBound( saveFile, result.bSuccess );
+	}
+
+	for ( const TSharedRef< TPromise< bool > >& promise : finished.Promises )
+	{
+		promise->SetValue( result.bSuccess );
+	}
+
+	OnSaveComplete.Broadcast( saveFile, result.bSuccess );
+
+	// The snapshot is on disk now, the live state stays with the game state and the managers
+	if ( saveFile )
+	{
+		saveFile->SavedState = FSerializedGameState();
+	}
+
+	// Everything that piled up while we were writing gets captured now, once per slot
+	if ( QueuedSaves.Num() > 0 )
+	{
+		FPendingSave next = MoveTemp( QueuedSaves[0] );
+		QueuedSaves.RemoveAt( 0 );
+		StartSaveWrite( MoveTemp( next ) );
+	}
+}
+
+bool UGameSaveManager::WriteSaveToSlot( USavedGameState* saveFile, const FString& slotName, FGameSaveSlotInfo* outInfo, FGameSaveJournal* journal )
+{
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_WriteSave );
+	LLM_SCOPE_BYTAG( GameSerializer_SaveFile );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "WriteSave %s" ), *slotName );
+
+	if ( !saveFile )
+	{
+		return false;
+	}
+
+	TArray< uint8 > bytes;
+
+	{
+		// Don't let GC run while we walk the save object's properties off the game thread
+		TOptional< FGCScopeGuard > gcGuard;
+
+		if ( !IsInGameThread() )
+		{
+			gcGuard.Emplace();
+		}
+
+		// Journals diff the save object right up to the write, their records are small enough to keep the guard through it
+		if ( journal )
+		{
+			int64 written = 0;
+
+			if ( !journal->Write( saveFile, outInfo, &written ) )
+			{
+				return false;
+			}
+
+			SET_MEMORY_STAT( STAT_GameSerializer_SaveBytes, written );
+			CSV_CUSTOM_STAT( GameSerializer, SaveBytes, (int32)written, ECsvCustomStatOp::Set );
+			return true;
+		}
+
+		if ( !FGameSaveContainer::Write( saveFile, bytes, outInfo ) )
+		{
+			return false;
+		}
+	}
+
+	if ( !UGameplayStatics::SaveDataToSlot( bytes, slotName, 0 ) )
 	{
-		ASerializationManager* manager = *Iter;
+		return false;
+	}
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Wrote %s! File size: %i bytes" ), *slotName, bytes.Num() );
+
+	SET_MEMORY_STAT( STAT_GameSerializer_SaveBytes, bytes.Num() );
+	CSV_CUSTOM_STAT( GameSerializer, SaveBytes, bytes.Num(), ECsvCustomStatOp::Set );
+	return true;
+}
+
+TArray<USavedGameState*> UGameSaveManager::GetSaves()
+{
+	const FGameSaveManifest& manifest = GetManifest();
+
+	// Slots are contiguous from 0, the first gap ends the list
+	int32 count = 0;
+
+	while ( count < SaveSlots::MaxSlots && manifest.Find( count ) )
+	{
+		count++;
+	}
+
+	if ( SavedGames.Num() < count )
+	{
+		SavedGames.SetNum( count );
+	}
+
+	for ( int32 index = 0; index < count; index++ )
+	{
+		if ( SavedGames[index] == nullptr )
+		{
+			USavedGameState* save = CreateSaveGame();
+			manifest.Find( index )->ApplyToSave( save );
+			SavedGames[index] = save;
+		}
+	}
+
+	return TArray< USavedGameState* >( SavedGames.GetData(), count );
+}
+
+TArray< FGameSaveSlotInfo > UGameSaveManager::GetSaveSlots()
+{
+	return GetManifest().Slots;
+}
+
+FGameSerializerMemoryReport UGameSaveManager::GetMemoryReport() const
+{
+	FGameSerializerMemoryReport report;
+	TMap< FName, FGameSerializerMemoryEntry > classes;
+
+	// Encoded worlds and resident captures can be shared by the game state, the managers and save objects, they're counted once
+	TSet< const void* > countedBuffers;
+
+	auto addWorld = [&report, &classes]( FName worldId, const FSerializedWorld& world, SIZE_T bytes )
+	{
+		FGameSerializerMemoryEntry& entry = report.Worlds.AddDefaulted_GetRef();
+		entry.Name = worldId;
+		entry.Bytes = bytes;
+		entry.Count = world.Actors.Num();
+
+		// Deduplicated actors share one arena span, it goes to the class of the first one
+		TSet< const uint8* > countedSpans;
+
+		for ( auto&& keypair : world.Actors )
+		{
+			const FName className = keypair.Value.ActorClass ? keypair.Value.ActorClass->GetFName() : NAME_None;
+			const TArrayView< const uint8 > blob = world.GetActorData( keypair.Value );
+
+			bool bSharedSpan = false;
+
+			if ( keypair.Value.ArenaOffset != INDEX_NONE && blob.Num() > 0 )
+			{
+				countedSpans.Add( blob.GetData(), &bSharedSpan );
+			}
+
+			FGameSerializerMemoryEntry& classEntry = classes.FindOrAdd( className );
+			classEntry.Name = className;
+			classEntry.Bytes += bSharedSpan ? 0 : blob.Num();
+			classEntry.Count++;
+		}
+	};
+
+	report.GameStateBytes = CurrentGameState.GetAllocatedSize( &countedBuffers );
+
+	for ( auto&& keypair : CurrentGameState.Worlds )
+	{
+		addWorld( keypair.Key, keypair.Value, keypair.Value.GetAllocatedSize() );
+	}
+
+	// A decoded world keeps its encoded copy around, both count towards the world
+	for ( auto&& keypair : CurrentGameState.EncodedWorlds )
+	{
+		FName worldId = keypair.Key;
+		FGameSerializerMemoryEntry* entry = report.Worlds.FindByPredicate( [worldId]( const FGameSerializerMemoryEntry& world ) { return world.Name == worldId; } );
+
+		if ( !entry )
+		{
+			entry = &report.Worlds.AddDefaulted_GetRef();
+			entry->Name = worldId;
+		}
+
+		entry->Bytes += keypair.Value.IsValid() ? keypair.Value->GetAllocatedSize() : 0;
+	}
+
+	for ( const ASerializationManager* manager : SerializationManagers )
+	{
+		if ( IsValid( manager ) )
+		{
+			const SIZE_T bytes = manager->GetWorldAllocatedSize( &countedBuffers );
+			report.ResidentWorldBytes += bytes;
+			addWorld( manager->WorldID, manager->GetWorldData(), bytes );
+		}
+	}
+
+	report.SessionSaveBytes = CurrentSessionSave ? CurrentSessionSave->GetAllocatedSize( &countedBuffers ) : 0;
+
+	for ( int32 index = 0; index < SavedGames.Num(); index++ )
+	{
+		if ( const USavedGameState* save = SavedGames[index] )
+		{
+			FGameSerializerMemoryEntry& entry = report.Slots.AddDefaulted_GetRef();
+			entry.Name = FName( *GetIndexedSaveName( index ) );
+			entry.Bytes = save->GetAllocatedSize( &countedBuffers );
+			entry.Count = save->SavedState.Worlds.Num() + save->SavedState.SharedWorlds.Num() + save->SavedState.EncodedWorlds.Num();
+
+			report.SavedGamesBytes += entry.Bytes;
+		}
+	}
+
+	classes.GenerateValueArray( report.Classes );
+
+	auto byBytes = []( const FGameSerializerMemoryEntry& a, const FGameSerializerMemoryEntry& b ) { return a.Bytes > b.Bytes; };
+	report.Worlds.Sort( byBytes );
+	report.Classes.Sort( byBytes );
+
+	return report;
+}
+
+void UGameSaveManager::DumpMemoryReport( FOutputDevice& Ar ) const
+{
+	const FGameSerializerMemoryReport report = GetMemoryReport();
+
+	Ar.Logf( TEXT( "GameSerializer memory: %.1f KB" ), report.GetTotalBytes() / 1024.0 );
+	Ar.Logf( TEXT( "  Game state      %10.1f KB" ), report.GameStateBytes / 1024.0 );
+	Ar.Logf( TEXT( "  Resident worlds %10.1f KB" ), report.ResidentWorldBytes / 1024.0 );
+	Ar.Logf( TEXT( "  Session save    %10.1f KB" ), report.SessionSaveBytes / 1024.0 );
+	Ar.Logf( TEXT( "  Saved games     %10.1f KB" ), report.SavedGamesBytes / 1024.0 );
+
+	auto dumpEntries = [&Ar]( const TCHAR* title, const TCHAR* countLabel, const TArray< FGameSerializerMemoryEntry >& entries )
+	{
+		Ar.Logf( TEXT( "%s:" ), title );
+
+		for ( const FGameSerializerMemoryEntry& entry : entries )
+		{
+			Ar.Logf( TEXT( "  %-40s %10.1f KB %8i %s" ), *entry.Name.ToString(), entry.Bytes / 1024.0, entry.Count, countLabel );
+		}
+	};
+
+	dumpEntries( TEXT( "Worlds" ), TEXT( "actors" ), report.Worlds );
+	dumpEntries( TEXT( "Actor blobs per class" ), TEXT( "actors" ), report.Classes );
+	dumpEntries( TEXT( "Slots" ), TEXT( "worlds" ), report.Slots );
+}
+
+void UGameSaveManager::GetResourceSizeEx( FResourceSizeEx& CumulativeResourceSize )
+{
+	Super::GetResourceSizeEx( CumulativeResourceSize );
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes( CurrentGameState.GetAllocatedSize() );
+}
+
+const FGameSaveManifest& UGameSaveManager::GetManifest()
+{
+	LLM_SCOPE_BYTAG( GameSerializer_SaveFile );
+
+	if ( Manifest.bLoaded || Manifest.Load( SavePrefix ) )
+	{
+		return Manifest;
+	}
+
+	// No manifest for this prefix yet, probe the slots once and write one
+	UE_LOG( LogSaveGame, Log, TEXT( "Rebuilding save manifest for prefix {%s}" ), *SavePrefix );
+
+	for ( int32 index = 0; index < SaveSlots::MaxSlots; index++ )
+	{
+		const FString slot = GetIndexedSaveName( index );
+		TUniquePtr< FGameSaveContainer > container = FGameSaveContainer::Open( slot, false );
+
+		// Containers only need their metadata section read, legacy slots get loaded whole
+		USavedGameState* save = container ? container->ReadHeader() : nullptr;
+
+		if ( !save )
+		{
+			UE_LOG( LogSaveGame, Log, TEXT( "Couldn't find save {%s}" ), *slot );
+			break;
+		}
+
+		save->bHeaderOnly = !container->IsLegacy();
+
+		FGameSaveSlotInfo info;
+		info.SlotIndex = index;
+		info.SlotName = slot;
+		info.FileSize = container->GetTotalSize();
+		info.UncompressedSize = info.FileSize;
+		info.CopyFromSave( save );
+
+		for ( const FGameSaveContainerSection& section : container->GetSections() )
+		{
+			info.UncompressedSize += section.RawSize - section.Size;
+		}
+
+		const FGameSaveContainerSection* thumbnail = container->FindSection( FGameSaveContainer::ThumbnailSection );
+
+		// A thumbnail the journal replaced has no place in the slot file
+		if ( thumbnail && !thumbnail->IsCompressed() && thumbnail->Offset != INDEX_NONE )
+		{
+			info.ThumbnailOffset = thumbnail->Offset;
+			info.ThumbnailSize = thumbnail->Size;
+		}
+
+		Manifest.Update( info );
+
+		// We paid for the read already, keep it
+		if ( !SavedGames.IsValidIndex( index ) )
+		{
+			SavedGames.SetNum( index + 1 );
+		}
+
+		if ( SavedGames[index] == nullptr )
+		{
+			SavedGames[index] = save;
+		}
+	}
+
+	Manifest.bLoaded = true;
+	Manifest.Save( SavePrefix );
+
+	return Manifest;
+}
+
+void UGameSaveManager::UpdateManifest( int32 index, const USavedGameState* saveFile, const FGameSaveSlotInfo& fileInfo )
+{
+	GetManifest();
+
+	FGameSaveSlotInfo info = fileInfo;
+	info.SlotIndex = index;
+	info.SlotName = GetIndexedSaveName( index );
+	info.CopyFromSave( saveFile );
+
+	Manifest.Update( info );
+
+	if ( !Manifest.Save( SavePrefix ) )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Failed to write save manifest for prefix {%s}" ), *SavePrefix );
+	}
+}
+
+void UGameSaveManager::SaveSessionState()
+{
+	check(IsValid(CurrentSessionSave));
+
+	SaveSessionToSaveObject(CurrentSessionSave);
+
+	UE_LOG(LogSaveGame, Verbose, TEXT("Saved current session!"));
+}
+
+FString UGameSaveManager::GetIndexedSaveName(int32 index) const
+{
+	return SavePrefix + "save_" + FString::FromInt( index );
+}
+
+void UGameSaveManager::AssignSavePrefix(FString Prefix)
+{
+	UE_LOG(LogSaveGame, Log, TEXT("Changed save manager prefix to %s"), *Prefix);
+	SavePrefix = Prefix;
+
+	// Slot lists are per prefix
+	Manifest.Reset();
+	SavedGames.Empty();
+}
+
+USavedGameState * UGameSaveManager::CreateSaveGame(FName NameOverride)
+{
+	TSubclassOf< USavedGameState > saveClass = USavedGameState::StaticClass();
+	UGameSerializerSettings* settings = GetMutableDefault< UGameSerializerSettings >();
+
+	if ( settings && settings->SaveClass )
+	{
+		saveClass = settings->SaveClass;
+	}
+
+	
+	return NewObject< USavedGameState >( this, saveClass, NameOverride );
+}
+
+void UGameSaveManager::LoadWorldState( FSerializedGameState&& state, bool bRestoreResidentWorlds )
+{
+	LLM_SCOPE_BYTAG( GameSerializer_WorldState );
+
+	CurrentGameState = MoveTemp( state );
+	WorldPrefetches.Empty();
+
+	// Snapshots taken by SaveSessionToSaveObject share their resident worlds, the game state keeps its own copy
+	for ( auto&& keypair : CurrentGameState.SharedWorlds )
+	{
+		// The encoded copy is older than the shared world, keeping it would make it look like a decode of that copy
+		if ( keypair.Value.IsValid() )
+		{
+			CurrentGameState.Worlds.Add( keypair.Key, *keypair.Value );
+			CurrentGameState.EncodedWorlds.Remove( keypair.Key );
+		}
+	}
+
+	CurrentGameState.SharedWorlds.Empty();
+
+	LoadPersistentObjects();
+
+	// Levels in play own their world's data, they either take the loaded one or let go of theirs so it can't overwrite it later
+	for ( ASerializationManager* manager : SerializationManagers )
+	{
+		if ( !IsValid( manager ) )
+		{
+			continue;
+		}
+
+		if ( bRestoreResidentWorlds )
+		{
+			manager->LoadWorldState( TakeWorldState( manager->WorldID ) );
+		}
+		else
+		{
+			manager->ReleaseWorldState();
+		}
+	}
+
+	UE_LOG( LogSaveGame, Verbose, TEXT( "Loaded world state!" ) );
+}
+
+void UGameSaveManager::LoadPersistentObjects()
+{
+	LLM_SCOPE_BYTAG( GameSerializer_Restore );
+	TRACE_CPUPROFILER_EVENT_SCOPE( UGameSaveManager::LoadPersistentObjects );
+
+	// Objects already persistent are matched to the save by id and overwritten in place
+	TMap< FName, UObject* > current;
+	current.Reserve( PersistentObjects.Num() );
+
+	for ( UObject* object : PersistentObjects )
+	{
+		if ( IsValid( object ) )
+		{
+			current.Add( USerializationHelpers::ResolveID( object ), object );
+		}
+	}
+
+	TArray< UObject* > loaded;
+	loaded.Reserve( CurrentGameState.PersistentObjects.Num() );
+
+	int32 reusedCount = 0;
+
+	for ( auto&& keypair : CurrentGameState.PersistentObjects )
+	{
+		if ( keypair.Key == NAME_None || !keypair.Value.ObjectClass )
+		{
+			UE_LOG( LogSaveGame, Warning, TEXT( "Invalid persistent object save %s!" ), *keypair.Key.ToString() );
+			continue;
+		}
+
+		UObject* object = nullptr;
+
+		if ( !current.RemoveAndCopyValue( keypair.Key, object ) )
+		{
+			// Released objects can still be around until the next GC, ones already marked for it only need to make room
+			object = FindObject< UObject >( GetTransientPackage(), *keypair.Key.ToString(), false );
+		}
+
+		if ( object && ( !IsValid( object ) || !object->IsA( keypair.Value.ObjectClass ) ) )
+		{
+			SavePersistentObjects::Retire( object );
+			object = nullptr;
+		}
+
+		if ( object )
+		{
+			SavePersistentObjects::ResetSaveGameProperties( object );
+			reusedCount++;
+		}
+		else
+		{
+			object = NewObject< UObject >( GetTransientPackage(), keypair.Value.ObjectClass, keypair.Value.UniqueId );
+			UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Created %s" ), *object->GetPathName() );
+		}
+
+		USerializationHelpers::LoadObject( object, keypair.Value, &CurrentGameState.References );
+		loaded.Add( object );
+	}
+
+	// Whatever the save doesn't know about is let go of, the regular GC collects it once nothing else holds it
+	PersistentObjects = MoveTemp( loaded );
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Loaded %i persistent objects, %i reused, %i released" ), PersistentObjects.Num(), reusedCount, current.Num() );
+}
+
+void UGameSaveManager::CacheWorld()
+{
+	GatherWorldStates();
+	CachePersistentState();
+}
+
+void UGameSaveManager::CachePersistentState()
+{
+	LLM_SCOPE_BYTAG( GameSerializer_Capture );
+
+	// Everything that indexes into the table is written again, so it starts over instead of collecting entries nothing uses anymore.
+	// Records of objects that were released since go with it.
+	CurrentGameState.References.Reset();
+	CurrentGameState.PersistentObjects.Reset();
+
+	for ( UObject* obj : PersistentObjects )
+	{
+		FName saveId = USerializationHelpers::ResolveID( obj );
+		CurrentGameState.PersistentObjects.Add( saveId, USerializationHelpers::SaveObject( obj, USerializationHelpers::GetReferenceTable( CurrentGameState.References ) ) );
+	}
+
+	APlayerController* controller = UGameplayStatics::GetPlayerController( this, 0 );
+	APlayerState* state = controller ? controller->GetPlayerState< APlayerState >() : nullptr;
+
+	if ( state )
+	{
+		CurrentGameState.SavedPlayerState = USerializationHelpers::SaveActor( state, USerializationHelpers::GetReferenceTable( CurrentGameState.References ) );
+	}
+	else
+	{
+		// The old record indexes into the table we just reset
+		CurrentGameState.SavedPlayerState = FSerializedActor();
+	}
+}
+
+void UGameSaveManager::GatherWorldStates()
+{
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_Gather );
+	LLM_SCOPE_BYTAG( GameSerializer_Capture );
+	TRACE_CPUPROFILER_EVENT_SCOPE( UGameSaveManager::GatherWorldStates );
+
+	TMap< UObject*, FName > worldPaths;
+	TArray< TSubclassOf< AActor > > typeBlacklist;
+
+	LastCaptureStats = FGameSerializerCaptureStats();
+
+	for ( ASerializationManager* manager : SerializationManagers )
+	{
+		if ( !IsValid( manager ) || !manager->OwnsWorldState() )
+		{
+			continue;
+		}
+
 		UObject* outer = manager->GetLevel()->GetOuter();
 
 		worldPaths.Add( outer, manager->WorldID );
-		manager->CacheWorldState();
+		manager->CacheWorld();
+
+		LastCaptureStats += manager->LastCaptureStats;
 	}
 
+	SaveStats::RecordCapture( LastCaptureStats, TEXT( "Captured world" ) );
+
 	//for ( TActorIterator< AActor > Iter( GetWorld() ); Iter; ++Iter )
 	//{
 	//	AActor* actor = *Iter;
@@ -371,12 +1432,11 @@ void UGameSaveManager::GatherWorldStates()
 void UGameSaveManager::CachePersistentObject( UObject* object )
 {
 	FName id = USerializationHelpers::ResolveID( object );
-	FSerializedGameObject data = USerializationHelpers::SaveObject( object );
-	CurrentGameState.PersistentObjects.Add( id, data );
+	CurrentGameState.PersistentObjects.Add( id, USerializationHelpers::SaveObject( object, USerializationHelpers::GetReferenceTable( CurrentGameState.References ) ) );
 	
 	PersistentObjects.Add( object );
 
-	UE_LOG( LogSaveGame, Warning, TEXT( "Cached %s" ), *id.ToString() );
+	UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Cached %s" ), *id.ToString() );
 }
 
 void UGameSaveManager::ReleasePersistentObject( UObject * object )
@@ -388,9 +1448,245 @@ void UGameSaveManager::ReleasePersistentObject( UObject * object )
 	}
 }
 
+void UGameSaveManager::MarkActorDirty( AActor* actor )
+{
+	if ( actor )
+	{
+		DirtyActors.Add( actor );
+	}
+}
+
+bool UGameSaveManager::ConsumeActorDirty( AActor* actor )
+{
+	return DirtyActors.Remove( actor ) > 0;
+}
+
+void UGameSaveManager::RegisterSerializationManager( ASerializationManager* manager )
+{
+	SerializationManagers.AddUnique( manager );
+
+	if ( manager && manager->GetLevel() )
+	{
+		CurrentGameState.LevelWorldIds.Add( SaveLevels::GetPackageKey( manager->GetLevel()->GetOutermost()->GetName() ), manager->WorldID );
+	}
+}
+
+void UGameSaveManager::HandleLevelStreamingStateChanged( UWorld* world, const ULevelStreaming* streamingLevel, ULevel* levelIfLoaded, ELevelStreamingState previousState, ELevelStreamingState newState )
+{
+	if ( !world || world->GetGameInstance() != GetGameInstance() || !streamingLevel )
+	{
+		return;
+	}
+
+	// Loading gives the decode the whole package load to hide behind
+	if ( newState != ELevelStreamingState::Loading && newState != ELevelStreamingState::LoadedNotVisible )
+	{
+		return;
+	}
+
+	const FName worldId = FindWorldIdForLevel( streamingLevel->GetWorldAssetPackageName() );
+
+	if ( !worldId.IsNone() )
+	{
+		PrefetchWorldState( worldId );
+	}
+}
+
+FName UGameSaveManager::FindWorldIdForLevel( const FString& packageName ) const
+{
+	const FName key = SaveLevels::GetPackageKey( packageName );
+
+	if ( const FName* worldId = CurrentGameState.LevelWorldIds.Find( key ) )
+	{
+		return *worldId;
+	}
+
+	// Saves from before the levels were recorded, managers are usually named after their level
+	const FName shortName( *FPackageName::GetShortName( key ) );
+	return HasWorldState( shortName ) ? shortName : NAME_None;
+}
+
+void UGameSaveManager::PrefetchWorldState( FName WorldID )
+{
+	const FEncodedWorldPtr* encoded = CurrentGameState.EncodedWorlds.Find( WorldID );
+
+	// Already decoded or resident, or nothing saved for it
+	if ( !encoded || CurrentGameState.Worlds.Contains( WorldID ) )
+	{
+		return;
+	}
+
+	if ( const FWorldPrefetch* existing = WorldPrefetches.Find( WorldID ) )
+	{
+		if ( existing->Source == *encoded )
+		{
+			return;
+		}
+	}
+
+	FWorldPrefetch& prefetch = WorldPrefetches.Add( WorldID );
+	prefetch.Source = *encoded;
+
+	DecodePrefetch( WorldID, prefetch.Source, false );
+}
+
+bool UGameSaveManager::IsWorldStatePrefetched( FName WorldID ) const
+{
+	const FWorldPrefetch* prefetch = WorldPrefetches.Find( WorldID );
+	return prefetch && prefetch->bReady;
+}
+
+void UGameSaveManager::DecodePrefetch( FName worldId, FEncodedWorldPtr source, bool bRetry )
+{
+	TWeakObjectPtr< UGameSaveManager > weakThis = this;
+
+	Async( EAsyncExecution::ThreadPool, [weakThis, worldId, source, bRetry]()
+	{
+		LLM_SCOPE_BYTAG( GameSerializer_WorldState );
+
+		TSharedPtr< FSerializedWorld, ESPMode::ThreadSafe > result = MakeShared< FSerializedWorld, ESPMode::ThreadSafe >();
+		TArray< FString > missingObjects;
+		bool bSuccess = false;
+
+		{
+			// Class lookups walk the object hash
+			FGCScopeGuard gcGuard;
+			bSuccess = FGameSaveContainer::DecodeWorld( *source, *result, &missingObjects );
+		}
+
+		AsyncTask( ENamedThreads::GameThread, [weakThis, worldId, source, result, missingObjects = MoveTemp( missingObjects ), bSuccess, bRetry]() mutable
+		{
+			if ( UGameSaveManager* manager = weakThis.Get() )
+			{
+				manager->FinishPrefetch( worldId, source, result, MoveTemp( missingObjects ), bSuccess, bRetry );
+			}
+		} );
+	} );
+}
+
+void UGameSaveManager::FinishPrefetch( FName worldId, FEncodedWorldPtr source, TSharedPtr< FSerializedWorld, ESPMode::ThreadSafe > result, TArray< FString >&& missingObjects, bool bSuccess, bool bRetry )
+{
+	FWorldPrefetch* prefetch = WorldPrefetches.Find( worldId );
+
+	// Taken synchronously in the meantime, or the world changed under us
+	if ( !prefetch || prefetch->Source != source )
+	{
+		return;
+	}
+
+	if ( !bSuccess )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Prefetch of world %s failed, it'll be decoded when its level loads" ), *worldId.ToString() );
+		WorldPrefetches.Remove( worldId );
+		return;
+	}
+
+	// Still missing after the packages loaded: objects that don't exist anymore, or ones the worker can't see.
+	// A synchronous decode resolves them the usual way, a half resolved world mustn't be handed out.
+	if ( missingObjects.Num() > 0 && bRetry )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Prefetch of world %s still misses %i objects, it'll be decoded when its level loads" ), *worldId.ToString(), missingObjects.Num() );
+		WorldPrefetches.Remove( worldId );
+		return;
+	}
+
+	if ( missingObjects.Num() > 0 )
+	{
+		TSet< FString > packages;
+
+		for ( const FString& path : missingObjects )
+		{
+			packages.Add( FPackageName::ObjectPathToPackageName( path ) );
+		}
+
+		// Once everything the world needs is in memory it's decoded again, this time nothing should be missing
+		TSharedRef< int32 > pending = MakeShared< int32 >( packages.Num() );
+
+		for ( const FString& package : packages )
+		{
+			LoadPackageAsync( package, FLoadPackageAsyncDelegate::CreateWeakLambda( this, [this, worldId, source, pending]( const FName&, UPackage*, EAsyncLoadingResult::Type )
+			{
+				if ( --( *pending ) == 0 )
+				{
+					DecodePrefetch( worldId, source, true );
+				}
+			} ) );
+		}
+
+		return;
+	}
+
+	prefetch->Result = result;
+	prefetch->bReady = true;
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Prefetched world %s: %i actors" ), *worldId.ToString(), result->Actors.Num() );
+}
+
+bool UGameSaveManager::ConsumePrefetch( FName worldId, FSerializedWorld& outWorld )
+{
+	FWorldPrefetch prefetch;
+
+	if ( !WorldPrefetches.RemoveAndCopyValue( worldId, prefetch ) || !prefetch.bReady )
+	{
+		return false;
+	}
+
+	const FEncodedWorldPtr* encoded = CurrentGameState.EncodedWorlds.Find( worldId );
+
+	if ( !encoded || *encoded != prefetch.Source )
+	{
+		return false;
+	}
+
+	outWorld = MoveTemp( *prefetch.Result );
+	return true;
+}
+
+void UGameSaveManager::UnregisterSerializationManager( ASerializationManager* manager )
+{
+	SerializationManagers.Remove( manager );
+
+	// Lookups of other worlds were for the level that's leaving, they don't need to stay decoded
+	ReleaseDecodedWorlds();
+}
+
+void UGameSaveManager::ReleaseDecodedWorlds()
+{
+	LLM_SCOPE_BYTAG( GameSerializer_WorldState );
+
+	for ( auto it = CurrentGameState.Worlds.CreateIterator(); it; ++it )
+	{
+		if ( CurrentGameState.EncodedWorlds.Contains( it.Key() ) )
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
+
+ASerializationManager* UGameSaveManager::FindSerializationManager( const ULevel* level ) const
+{
+	for ( ASerializationManager* manager : SerializationManagers )
+	{
+		if ( IsValid( manager ) && manager->GetLevel() == level )
+		{
+			return manager;
+		}
+	}
+
+	return nullptr;
+}
+
 void UGameSaveManager::LoadedActor( AActor * actor )
 {
-	UE_LOG( LogSaveGame, Warning, TEXT( "Loaded level actor %s" ), *actor->GetName() );
+	UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Loaded level actor %s" ), *actor->GetName() );
+
+	if ( ASerializationManager::IsSerializableActor( actor ) )
+	{
+		if ( ASerializationManager* manager = FindSerializationManager( actor->GetLevel() ) )
+		{
+			manager->RegisterActor( actor );
+		}
+	}
 
 	APlayerState* state = Cast< APlayerState >( actor );
 
@@ -402,4 +1698,34 @@ void UGameSaveManager::LoadedActor( AActor * actor )
 
 void UGameSaveManager::UnloadedActor( AActor * actor )
 {
+	// Destroyed actors are never captured again, their mark would stay forever
+	DirtyActors.Remove( actor );
+
+	if ( ASerializationManager::IsSerializableActor( actor ) )
+	{
+		if ( ASerializationManager* manager = FindSerializationManager( actor->GetLevel() ) )
+		{
+			// A running capture still gets to see it
+			manager->CaptureActorNow( actor );
+			manager->UnregisterActor( actor );
+		}
+	}
 }
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice GGameSerializerMemReportCommand(
+	TEXT( "GameSerializer.MemReport" ),
+	TEXT( "Prints the memory the save manager and serialization managers hold, per world, actor class and slot." ),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda( []( const TArray< FString >& args, UWorld* world, FOutputDevice& Ar )
+	{
+		UGameInstance* gameInstance = world ? world->GetGameInstance() : nullptr;
+		UGameSaveManager* manager = gameInstance ? gameInstance->GetSubsystem< UGameSaveManager >() : nullptr;
+
+		if ( manager )
+		{
+			manager->DumpMemoryReport( Ar );
+		}
+		else
+		{
+			Ar.Log( TEXT( "No game save manager in this world" ) );
+		}
+	} ) );
@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameAutosaveScheduler.h"
+
+#include "Classes.h"
+#include "GameSerializer.h"
+#include "GameSerializerSettings.h"
+
+#include "Engine/GameInstance.h"
+#include "Misc/App.h"
+
+void UGameAutosaveScheduler::Initialize( FSubsystemCollectionBase& Collection )
+{
+	Super::Initialize( Collection );
+
+	SaveManager = Cast< UGameSaveManager >( Collection.InitializeDependency( UGameSaveManager::StaticClass() ) );
+
+	if ( SaveManager )
+	{
+		SaveManager->OnSaveComplete.AddDynamic( this, &UGameAutosaveScheduler::HandleSaveComplete );
+	}
+
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	bEnabled = settings && settings->bAutosave;
+
+	// The first interval runs from the start of the session
+	LastSaveTime = FPlatformTime::Seconds();
+}
+
+void UGameAutosaveScheduler::Deinitialize()
+{
+	if ( SaveManager )
+	{
+		SaveManager->OnSaveComplete.RemoveDynamic( this, &UGameAutosaveScheduler::HandleSaveComplete );
+	}
+
+	SaveManager = nullptr;
+	bEnabled = false;
+	bRequested = false;
+
+	Super::Deinitialize();
+}
+
+void UGameAutosaveScheduler::BlockAutosave( FName Reason )
+{
+	Blocks.FindOrAdd( Reason )++;
+}
+
+void UGameAutosaveScheduler::UnblockAutosave( FName Reason )
+{
+	int32* count = Blocks.Find( Reason );
+
+	if ( !count )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Autosave isn't blocked by %s" ), *Reason.ToString() );
+		return;
+	}
+
+	if ( --( *count ) <= 0 )
+	{
+		Blocks.Remove( Reason );
+	}
+}
+
+void UGameAutosaveScheduler::RequestAutosave()
+{
+	bRequested = true;
+}
+
+void UGameAutosaveScheduler::SetAutosaveEnabled( bool bInEnabled )
+{
+	bEnabled = bInEnabled;
+}
+
+float UGameAutosaveScheduler::GetTimeUntilAutosave() const
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	if ( bRequested || !settings )
+	{
+		return 0.f;
+	}
+
+	return FMath::Max( (float)( LastSaveTime + settings->AutosaveIntervalSeconds - FPlatformTime::Seconds() ), 0.f );
+}
+
+ETickableTickType UGameAutosaveScheduler::GetTickableTickType() const
+{
+	return HasAnyFlags( RF_ClassDefaultObject ) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+void UGameAutosaveScheduler::Tick( float DeltaTime )
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	if ( !settings )
+	{
+		return;
+	}
+
+	// The frame that just ended, real time rather than the dilated DeltaTime, minus the wait for vsync or the frame rate limit
+	const int32 previousFrames = FMath::Max( settings->AutosaveCheapFrames, 1 ) - 1;
+
+	RecentFrameMs.Add( (float)FMath::Max( FApp::GetDeltaTime() - FApp::GetIdleTime(), 0.0 ) * 1000.f );
+
+	if ( RecentFrameMs.Num() > previousFrames )
+	{
+		RecentFrameMs.RemoveAt( 0, RecentFrameMs.Num() - previousFrames, false );
+	}
+
+	const double now = FPlatformTime::Seconds();
+
+	if ( !bRequested && now - LastSaveTime < settings->AutosaveIntervalSeconds )
+	{
+		DueSince = 0.0;
+		return;
+	}
+
+	if ( DueSince == 0.0 )
+	{
+		DueSince = now;
+	}
+
+	const TCHAR* reason = GetDeferReason();
+
+	// Frames that never get cheap enough can't put the autosave off forever
+	if ( reason && settings->AutosaveMaxDeferralSeconds > 0.f && now - DueSince >= settings->AutosaveMaxDeferralSeconds && !GetDeferReason( true ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Autosave was deferred for %.1f s, forcing it although %s" ), now - DueSince, reason );
+		reason = nullptr;
+	}
+
+	if ( reason )
+	{
+		UE_LOG( LogSaveGame, VeryVerbose, TEXT( "Autosave deferred, %s" ), reason );
+		return;
+	}
+
+	StartAutosave();
+}
+
+const TCHAR* UGameAutosaveScheduler::GetDeferReason( bool bIgnoreFrameBudget ) const
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	if ( !SaveManager || !settings )
+	{
+		return TEXT( "there's no save manager" );
+	}
+
+	if ( Blocks.Num() > 0 )
+	{
+		return TEXT( "game code blocked it" );
+	}
+
+	// Back pressure, a save that's still capturing or writing isn't queued behind
+	if ( SaveManager->IsSaveInProgress() )
+	{
+		return TEXT( "the last save is still being written" );
+	}
+
+	if ( SaveManager->bIsLoading || SaveManager->IsRestoringWorlds() )
+	{
+		return TEXT( "worlds are still being restored" );
+	}
+
+	if ( FPlatformTime::Seconds() - LastSaveTime < settings->AutosaveMinSpacingSeconds )
+	{
+		return TEXT( "the last save was too recent" );
+	}
+
+	if ( bIgnoreFrameBudget )
+	{
+		return nullptr;
+	}
+
+	// A capture that cost more than the budget would leave no frame cheap enough, at most half of it is kept free
+	const float captureMs = settings->bAmortizeAutosave ? settings->CaptureBudgetMs : LastCaptureMs;
+	const float reservedMs = FMath::Min( FMath::Max( settings->AutosaveHeadroomMs, captureMs ), settings->AutosaveFrameBudgetMs * 0.5f );
+	const float allowedMs = settings->AutosaveFrameBudgetMs - reservedMs;
+
+	if ( RecentFrameMs.Num() < FMath::Max( settings->AutosaveCheapFrames, 1 ) - 1 )
+	{
+		return TEXT( "there aren't enough frames measured yet" );
+	}
+
+	for ( float frameMs : RecentFrameMs )
+	{
+		if ( frameMs > allowedMs )
+		{
+			return TEXT( "recent frames didn't leave enough room" );
+		}
+	}
+
+	// What this frame has taken so far, tickables run late enough in it for that to be most of it
+	if ( !FApp::UseFixedTimeStep() && ( FPlatformTime::Seconds() - FApp::GetCurrentTime() ) * 1000.0 > allowedMs )
+	{
+		return TEXT( "this frame is already busy" );
+	}
+
+	return nullptr;
+}
+
+void UGameAutosaveScheduler::StartAutosave()
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	const int32 slot = settings->AutosaveSlot >= 0 ? settings->AutosaveSlot : FMath::Max( SaveManager->CurrentSlot, 0 );
+	const double start = FPlatformTime::Seconds();
+	const double waited = start - DueSince;
+
+	bRequested = false;
+	DueSince = 0.0;
+	LastSaveTime = start;
+
+	OnAutosaveStarted.Broadcast( slot );
+
+	SaveManager->SaveGameToSlotAsync( slot, FGameSaveCompleteDelegate(), settings->bAmortizeAutosave );
+
+	LastCaptureMs = (float)( ( FPlatformTime::Seconds() - start ) * 1000.0 );
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Autosaving to slot %i after waiting %.1f s for a quiet frame, %.2f ms on the game thread" ), slot, waited, LastCaptureMs );
+}
+
+void UGameAutosaveScheduler::HandleSaveComplete( USaveGame* save, bool bSuccess )
+{
+	if ( bSuccess )
+	{
+		LastSaveTime = FPlatformTime::Seconds();
+	}
+}
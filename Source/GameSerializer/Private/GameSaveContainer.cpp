@@ -0,0 +1,1343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameSaveContainer.h"
+
+#include "Classes.h"
+#include "GameSerializer.h"
+#include "GameSerializerSettings.h"
+#include "GameSerializerStats.h"
+#include "SaveGameManifest.h"
+#include "GameSaveJournal.h"
+#include "GameSerializerTransformCodec.h"
+
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Compression.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/Paths.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+const TCHAR* FGameSaveContainer::MetadataSection = TEXT( "Metadata" );
+const TCHAR* FGameSaveContainer::ThumbnailSection = TEXT( "Thumbnail" );
+const TCHAR* FGameSaveContainer::PersistentObjectsSection = TEXT( "PersistentObjects" );
+const TCHAR* FGameSaveContainer::PlayerStateSection = TEXT( "PlayerState" );
+const TCHAR* FGameSaveContainer::ReferencesSection = TEXT( "References" );
+const TCHAR* FGameSaveContainer::LevelsSection = TEXT( "Levels" );
+const TCHAR* FGameSaveContainer::JournalSection = TEXT( "Journal" );
+
+namespace SaveContainer
+{
+	static const uint32 Magic = 0x4E435347; // "GSCN"
+	static const uint32 LegacyMagic = 0x53415647; // "GVAS", what UGameplayStatics::SaveGameToMemory writes
+	static const int32 Version = 3;
+
+	/** Containers from before world sections had a header of their own, laid out like the current version otherwise. */
+	static const int32 UnversionedWorldsVersion = 2;
+
+	/** Containers from before sections could be compressed. */
+	static const int32 UncompressedVersion = 1;
+
+	/** Sections start aligned so mapped thumbnails and blobs can be read in place. */
+	static const int64 SectionAlignment = 16;
+
+	static const TCHAR* WorldPrefix = TEXT( "World." );
+
+	/** Starts every patch appended to a world section. */
+	static const uint32 PatchMagic = 0x50575347; // "GSWP"
+
+	/** Starts a world section, followed by its version. */
+	static const uint32 WorldMagic = 0x53575347; // "GSWS"
+
+	/** World sections without the header: the records hold the transforms, and whatever follows the arena is patches. */
+	static const int32 UnpackedTransformsWorldVersion = 1;
+
+	/** The transforms are packed after the arena, patches carry the codec of each actor they change. */
+	static const int32 WorldVersion = 2;
+
+	/** Reads a world section's version, leaving sections without a header at their start. */
+	static int32 ReadWorldVersion( FArchive& reader )
+	{
+		const int64 start = reader.Tell();
+
+		// Older sections start with the length of a property name, nowhere near the magic
+		if ( reader.TotalSize() - start >= (int64)( sizeof( uint32 ) + sizeof( int32 ) ) )
+		{
+			uint32 magic = 0;
+			reader << magic;
+
+			if ( magic == WorldMagic )
+			{
+				int32 version = 0;
+				reader << version;
+				return version;
+			}
+
+			reader.Seek( start );
+		}
+
+		return UnpackedTransformsWorldVersion;
+	}
+
+	/** Serializes the save object like UGameplayStatics does, minus the parts that live in their own sections. */
+	class FMetadataArchive : public FObjectAndNameAsStringProxyArchive
+	{
+	public:
+
+		FMetadataArchive( FArchive& inner )
+			: FObjectAndNameAsStringProxyArchive( inner, true )
+		{
+			ArIsSaveGame = true;
+			ArNoDelta = true;
+		}
+
+		virtual bool ShouldSkipProperty( const FProperty* property ) const override
+		{
+			const FName name = property->GetFName();
+			return name == GET_MEMBER_NAME_CHECKED( USavedGameState, SavedState ) || name == GET_MEMBER_NAME_CHECKED( USavedGameState, ScreenshotPixels );
+		}
+	};
+
+	/** Writes a world without its actors' transforms, FGameSerializerTransformCodec packs those after the arena. */
+	class FWorldArchive : public FObjectAndNameAsStringProxyArchive
+	{
+	public:
+
+		FWorldArchive( FArchive& inner )
+			: FObjectAndNameAsStringProxyArchive( inner, true )
+		{
+			ArIsSaveGame = true;
+			ArNoDelta = true;
+		}
+
+		virtual bool ShouldSkipProperty( const FProperty* property ) const override
+		{
+			return property->GetFName() == GET_MEMBER_NAME_CHECKED( FSerializedActor, ActorTransform ) && property->GetOwnerStruct() == FSerializedActor::StaticStruct();
+		}
+	};
+
+	/** Only ever finds objects, the paths it couldn't find get collected for whoever wants to load them. */
+	class FFindOnlyArchive : public FObjectAndNameAsStringProxyArchive
+	{
+	public:
+
+		FFindOnlyArchive( FArchive& inner, TArray< FString >& missing )
+			: FObjectAndNameAsStringProxyArchive( inner, false )
+			, Missing( missing )
+		{
+			ArIsSaveGame = true;
+			ArNoDelta = true;
+		}
+
+		virtual FArchive& operator<<( UObject*& obj ) override
+		{
+			if ( !IsLoading() )
+			{
+				return FObjectAndNameAsStringProxyArchive::operator<<( obj );
+			}
+
+			FString path;
+			InnerArchive << path;
+
+			obj = path.IsEmpty() ? nullptr : FindObject< UObject >( nullptr, *path );
+
+			if ( !obj && !path.IsEmpty() )
+			{
+				Missing.AddUnique( path );
+			}
+
+			return *this;
+		}
+
+	private:
+
+		TArray< FString >& Missing;
+	};
+
+	static void SerializeStruct( FArchive& inner, UScriptStruct* type, void* data )
+	{
+		FObjectAndNameAsStringProxyArchive ar( inner, true );
+		ar.ArIsSaveGame = true;
+		ar.ArNoDelta = true;
+
+		type->SerializeItem( ar, data, nullptr );
+	}
+
+	/** Like SerializeStruct, only finding objects and collecting the missing ones when missing is given. */
+	static void SerializeWorldStruct( FArchive& inner, UScriptStruct* type, void* data, TArray< FString >* missing )
+	{
+		if ( missing )
+		{
+			FFindOnlyArchive ar( inner, *missing );
+			type->SerializeItem( ar, data, nullptr );
+		}
+		else
+		{
+			SerializeStruct( inner, type, data );
+		}
+	}
+
+	/** Applies one patch written by FGameSaveContainer::EncodeWorldPatch to a world section of the given version. */
+	static bool ApplyWorldPatch( FArchive& reader, FSerializedWorld& world, TArray< FString >* missing, int32 worldVersion )
+	{
+		uint32 magic = 0;
+		uint8 bLoaded = 0;
+		int32 baseNames = 0;
+		int32 basePaths = 0;
+
+		reader << magic;
+		reader << bLoaded;
+		reader << baseNames;
+		reader << basePaths;
+
+		// The patch was made against a table this world doesn't have, its indices would point at the wrong entries
+		if ( reader.IsError() || magic != PatchMagic || baseNames != world.References.Names.Num() || basePaths != world.References.ObjectPaths.Num() )
+		{
+			return false;
+		}
+
+		world.bLoaded = bLoaded != 0;
+
+		TArray< FString > names;
+		TArray< FString > paths;
+		TArray< int64 > removed;
+
+		reader << names;
+		reader << paths;
+		reader << removed;
+
+		for ( const FString& name : names )
+		{
+			world.References.Names.Add( FName( *name ) );
+		}
+
+		world.References.ObjectPaths.Append( MoveTemp( paths ) );
+
+		for ( int64 id : removed )
+		{
+			world.Actors.Remove( id );
+		}
+
+		int32 count = 0;
+		reader << count;
+
+		for ( int32 index = 0; index < count && !reader.IsError(); index++ )
+		{
+			int64 id = 0;
+			reader << id;
+
+			FSerializedActor actor;
+			SerializeWorldStruct( reader, FSerializedActor::StaticStruct(), &actor, missing );
+
+			// Patches of older sections left the codec out, their actors stay Full
+			if ( worldVersion >= WorldVersion )
+			{
+				uint8 codec = 0;
+				reader << codec;
+
+				if ( codec > (uint8)EGameSerializerTransformCodec::Quantized )
+				{
+					return false;
+				}
+
+				actor.TransformCodec = (EGameSerializerTransformCodec)codec;
+			}
+
+			int32 size = 0;
+			reader << size;
+
+			if ( reader.IsError() || size < 0 || size > reader.TotalSize() - reader.Tell() )
+			{
+				return false;
+			}
+
+			actor.ArenaOffset = world.ActorArena.Num();
+			actor.ArenaSize = size;
+
+			world.ActorArena.AddUninitialized( size );
+			reader.Serialize( world.ActorArena.GetData() + actor.ArenaOffset, size );
+
+			world.Actors.Add( id, MoveTemp( actor ) );
+		}
+
+		return !reader.IsError();
+	}
+
+	static FMemoryReaderView MakeReader( TArrayView< const uint8 > data )
+	{
+		return FMemoryReaderView( FMemoryView( data.GetData(), data.Num() ), true );
+	}
+
+	static FName GetCompressionFormat( EGameSerializerCompression compression )
+	{
+		switch ( compression )
+		{
+		case EGameSerializerCompression::Zlib:
+			return NAME_Zlib;
+		case EGameSerializerCompression::LZ4:
+			return NAME_LZ4;
+		case EGameSerializerCompression::Oodle:
+			return FCompression::IsFormatValid( NAME_Oodle ) ? NAME_Oodle : NAME_Zlib;
+		default:
+			return NAME_None;
+		}
+	}
+
+	/** A compressed section is a block count, the compressed size of each block, then the blocks back to back. */
+	static int64 GetBlockTableSize( int32 blockCount )
+	{
+		return sizeof( int32 ) * ( 1 + (int64)blockCount );
+	}
+}
+
+FString FGameSaveContainer::GetWorldSectionName( FName worldId )
+{
+	return FString( SaveContainer::WorldPrefix ) + worldId.ToString();
+}
+
+FString FGameSaveContainer::GetSlotFilePath( const FString& slotName )
+{
+	// Mirrors FGenericSaveGameSystem, which keeps its path to itself
+	return FPaths::ProjectSavedDir() / TEXT( "SaveGames" ) / slotName + TEXT( ".sav" );
+}
+
+bool FGameSaveContainer::IsSlotFileBacked()
+{
+	// Platforms with their own save system override GetSaveGameSystem, the base one hands out the generic system
+	IPlatformFeaturesModule& features = IPlatformFeaturesModule::Get();
+	return features.GetSaveGameSystem() == features.IPlatformFeaturesModule::GetSaveGameSystem();
+}
+
+bool FGameSaveContainer::ReplaceFile( const FString& path, TArrayView< const uint8 > bytes )
+{
+	const FString tempPath = path + TEXT( ".tmp" );
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	platformFile.CreateDirectoryTree( *FPaths::GetPath( path ) );
+
+	{
+		TUniquePtr< IFileHandle > file( platformFile.OpenWrite( *tempPath ) );
+
+		if ( !file || !file->Write( bytes.GetData(), bytes.Num() ) || !file->Flush( true ) )
+		{
+			file.Reset();
+			platformFile.DeleteFile( *tempPath );
+			return false;
+		}
+	}
+
+	// The old file is only deleted once the new one is whole on disk
+	return IFileManager::Get().Move( *path, *tempPath, true, true, false, true );
+}
+
+void FGameSaveContainer::RecoverFile( const FString& path )
+{
+	const FString tempPath = path + TEXT( ".tmp" );
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// A temporary next to the file is half written, one without it was flushed before the old file went away
+	if ( !platformFile.FileExists( *path ) && platformFile.FileExists( *tempPath ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Finishing an interrupted write of %s" ), *path );
+		platformFile.MoveFile( *path, *tempPath );
+	}
+}
+
+bool FGameSaveContainer::Write( USavedGameState* save, TArray< uint8 >& outBytes, FGameSaveSlotInfo* outInfo, FGameSaveContainerStats* outStats, const FGuid& journalId, int32 journalRecords )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveContainer::Write );
+
+	if ( !save )
+	{
+		return false;
+	}
+
+	TArray< FString > names;
+	TArray< TArray< uint8 > > payloads;
+
+	BuildSections( save, true, names, payloads );
+
+	return WriteSections( save->GetClass()->GetPathName(), MoveTemp( names ), MoveTemp( payloads ), outBytes, outInfo, outStats, journalId, journalRecords );
+}
+
+bool FGameSaveContainer::WriteSections( const FString& saveClassPath, TArray< FString > names, TArray< TArray< uint8 > > payloads, TArray< uint8 >& outBytes, FGameSaveSlotInfo* outInfo, FGameSaveContainerStats* outStats, const FGuid& journalId, int32 journalRecords )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveContainer::WriteSections );
+
+	if ( journalId.IsValid() )
+	{
+		names.Add( JournalSection );
+		FMemoryWriter writer( payloads.AddDefaulted_GetRef(), true );
+		FGuid id = journalId;
+		writer << id;
+		writer << journalRecords;
+	}
+
+	TArray< FGameSaveContainerSection > toc;
+	toc.SetNum( names.Num() );
+
+	for ( int32 index = 0; index < toc.Num(); index++ )
+	{
+		toc[index].Name = MoveTemp( names[index] );
+		toc[index].Size = payloads[index].Num();
+		toc[index].RawSize = payloads[index].Num();
+	}
+
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	const FName format = settings ? SaveContainer::GetCompressionFormat( settings->Compression ) : NAME_None;
+	const int32 blockSize = settings ? FMath::Max( settings->CompressionBlockSizeKB, 16 ) * 1024 : 0;
+
+	FGameSaveContainerStats stats;
+	const double compressStart = FPlatformTime::Seconds();
+
+	struct FBlock
+	{
+		int32 Section;
+		int32 RawOffset;
+		int32 RawSize;
+		TArray< uint8 > Compressed;
+	};
+
+	/** Blocks of a section that's stored compressed, they go straight from here into the output. */
+	struct FPackedSection
+	{
+		int32 FirstBlock = 0;
+		int32 BlockCount = 0;
+	};
+
+	TArray< FBlock > blocks;
+	TMap< int32, FPackedSection > packedSections;
+
+	if ( !format.IsNone() )
+	{
+		// Every block of every section goes into the same ParallelFor, so one huge world doesn't serialize the rest
+		for ( int32 index = 0; index < payloads.Num(); index++ )
+		{
+			const int32 payloadSize = payloads[index].Num();
+
+			for ( int32 rawOffset = 0; rawOffset < payloadSize; rawOffset += blocks.Last().RawSize )
+			{
+				FBlock& block = blocks.AddDefaulted_GetRef();
+				block.Section = index;
+				block.RawOffset = rawOffset;
+				block.RawSize = FMath::Min( blockSize, payloadSize - rawOffset );
+			}
+		}
+
+		ParallelFor( blocks.Num(), [&blocks, &payloads, format]( int32 blockIndex )
+		{
+			FBlock& block = blocks[blockIndex];
+
+			int32 compressedSize = FCompression::CompressMemoryBound( format, block.RawSize );
+			block.Compressed.SetNumUninitialized( compressedSize );
+
+			if ( FCompression::CompressMemory( format, block.Compressed.GetData(), compressedSize, payloads[block.Section].GetData() + block.RawOffset, block.RawSize ) )
+			{
+				block.Compressed.SetNum( compressedSize, false );
+			}
+			else
+			{
+				block.Compressed.Reset();
+			}
+		} );
+
+		int32 firstBlock = 0;
+
+		for ( int32 index = 0; index < payloads.Num(); index++ )
+		{
+			int32 blockCount = 0;
+			int64 compressedSize = 0;
+			bool bFailed = false;
+
+			while ( firstBlock + blockCount < blocks.Num() && blocks[firstBlock + blockCount].Section == index )
+			{
+				const FBlock& block = blocks[firstBlock + blockCount];
+				bFailed |= block.Compressed.Num() == 0;
+				compressedSize += block.Compressed.Num();
+				blockCount++;
+			}
+
+			const int64 packedSize = SaveContainer::GetBlockTableSize( blockCount ) + compressedSize;
+
+			// Sections that don't get any smaller are stored, readers then skip the inflate too
+			if ( blockCount > 0 && !bFailed && packedSize < payloads[index].Num() )
+			{
+				FPackedSection& packed = packedSections.Add( index );
+				packed.FirstBlock = firstBlock;
+				packed.BlockCount = blockCount;
+
+				// The raw payload isn't needed anymore
+				payloads[index].Empty();
+
+				toc[index].Size = packedSize;
+				toc[index].Compression = format;
+				toc[index].BlockSize = blockSize;
+			}
+
+			firstBlock += blockCount;
+		}
+	}
+
+	for ( const FGameSaveContainerSection& section : toc )
+	{
+		stats.RawSize += section.RawSize;
+		stats.StoredSize += section.Size;
+	}
+
+	stats.Seconds = FPlatformTime::Seconds() - compressStart;
+
+	FString classPath = saveClassPath;
+
+	auto writeHeader = [&classPath, &toc]( FArchive& ar )
+	{
+		uint32 magic = SaveContainer::Magic;
+		int32 version = SaveContainer::Version;
+
+		ar << magic;
+		ar << version;
+		ar << classPath;
+		ar << toc;
+	};
+
+	outBytes.Reset();
+	FMemoryWriter writer( outBytes, true );
+
+	// The header's size doesn't depend on the offsets, so write it once to measure and again once they're known
+	writeHeader( writer );
+
+	int64 offset = Align( (int64)outBytes.Num(), SaveContainer::SectionAlignment );
+
+	for ( FGameSaveContainerSection& section : toc )
+	{
+		section.Offset = offset;
+		offset = Align( offset + section.Size, SaveContainer::SectionAlignment );
+	}
+
+	if ( offset > MAX_int32 )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Save container would be %lld bytes, more than a save slot can hold" ), offset );
+		outBytes.Reset();
+		return false;
+	}
+
+	writer.Seek( 0 );
+	writeHeader( writer );
+
+	outBytes.SetNumZeroed( offset );
+
+	for ( int32 index = 0; index < toc.Num(); index++ )
+	{
+		const FPackedSection* packed = packedSections.Find( index );
+
+		if ( !packed )
+		{
+			FMemory::Memcpy( outBytes.GetData() + toc[index].Offset, payloads[index].GetData(), toc[index].Size );
+			continue;
+		}
+
+		// Compressed blocks are copied once, from where they were compressed to where they're stored
+		writer.Seek( toc[index].Offset );
+
+		int32 blockCount = packed->BlockCount;
+		writer << blockCount;
+
+		for ( int32 block = 0; block < blockCount; block++ )
+		{
+			int32 size = blocks[packed->FirstBlock + block].Compressed.Num();
+			writer << size;
+		}
+
+		for ( int32 block = 0; block < blockCount; block++ )
+		{
+			TArray< uint8 >& compressed = blocks[packed->FirstBlock + block].Compressed;
+			writer.Serialize( compressed.GetData(), compressed.Num() );
+		}
+	}
+
+	if ( !format.IsNone() )
+	{
+		UE_LOG( LogSaveGame, Log, TEXT( "Compressed save sections with %s: %lld -> %lld bytes (%.1f%%) in %.2f ms" ), *format.ToString(), stats.RawSize, stats.StoredSize, stats.GetRatio() * 100.0, stats.Seconds * 1000.0 );
+	}
+
+	if ( outStats )
+	{
+		*outStats = stats;
+	}
+
+	if ( outInfo )
+	{
+		outInfo->FileSize = outBytes.Num();
+		outInfo->UncompressedSize = outBytes.Num() + stats.RawSize - stats.StoredSize;
+		outInfo->ThumbnailOffset = INDEX_NONE;
+		outInfo->ThumbnailSize = 0;
+
+		for ( const FGameSaveContainerSection& section : toc )
+		{
+			if ( section.Name == ThumbnailSection && !section.IsCompressed() )
+			{
+				outInfo->ThumbnailOffset = section.Offset;
+				outInfo->ThumbnailSize = section.Size;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FGameSaveContainer::BuildSections( USavedGameState* save, bool bIncludeWorlds, TArray< FString >& outNames, TArray< TArray< uint8 > >& outPayloads )
+{
+	auto addSection = [&outNames, &outPayloads]( const FString& name ) -> TArray< uint8 >&
+	{
+		outNames.Add( name );
+		return outPayloads.AddDefaulted_GetRef();
+	};
+
+	{
+		FMemoryWriter writer( addSection( MetadataSection ), true );
+		SaveContainer::FMetadataArchive ar( writer );
+		save->Serialize( ar );
+	}
+
+	if ( save->ScreenshotPixels.Num() > 0 )
+	{
+		addSection( ThumbnailSection ).Append( reinterpret_cast< const uint8* >( save->ScreenshotPixels.GetData() ), save->ScreenshotPixels.Num() * sizeof( FColor ) );
+	}
+
+	FSerializedGameState& state = save->SavedState;
+
+	if ( bIncludeWorlds )
+	{
+		state.ForEachDecodedWorld( [&addSection]( FName worldId, const FSerializedWorld& world )
+		{
+			EncodeWorld( world, addSection( GetWorldSectionName( worldId ) ) );
+		} );
+
+		// Worlds nobody decoded go out as they came in
+		for ( auto&& keypair : state.EncodedWorlds )
+		{
+			if ( keypair.Value.IsValid() && !state.FindDecodedWorld( keypair.Key ) )
+			{
+				addSection( GetWorldSectionName( keypair.Key ) ) = *keypair.Value;
+			}
+		}
+	}
+
+	{
+		FMemoryWriter writer( addSection( PersistentObjectsSection ), true );
+
+		int32 count = state.PersistentObjects.Num();
+		writer << count;
+
+		for ( auto&& keypair : state.PersistentObjects )
+		{
+			FString id = keypair.Key.ToString();
+			writer << id;
+			SaveContainer::SerializeStruct( writer, FSerializedGameObject::StaticStruct(), &keypair.Value );
+		}
+	}
+
+	{
+		FMemoryWriter writer( addSection( PlayerStateSection ), true );
+		SaveContainer::SerializeStruct( writer, FSerializedActor::StaticStruct(), &state.SavedPlayerState );
+	}
+
+	{
+		FMemoryWriter writer( addSection( ReferencesSection ), true );
+		SaveContainer::SerializeStruct( writer, FGameSerializerReferenceTable::StaticStruct(), &state.References );
+	}
+
+	{
+		FMemoryWriter writer( addSection( LevelsSection ), true );
+		writer << state.LevelWorldIds;
+	}
+}
+
+TUniquePtr< FGameSaveContainer > FGameSaveContainer::Open( const FString& slotName, bool bReplayJournal )
+{
+	TUniquePtr< FGameSaveContainer > container( new FGameSaveContainer() );
+
+	if ( IsSlotFileBacked() )
+	{
+		RecoverFile( GetSlotFilePath( slotName ) );
+
+		IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+		container->MappedFile.Reset( platformFile.OpenMapped( *GetSlotFilePath( slotName ) ) );
+	}
+
+	// Views are int32 sized, bigger files go through the save system and fail there
+	if ( container->MappedFile && container->MappedFile->GetFileSize() > 0 && container->MappedFile->GetFileSize() <= MAX_int32 )
+	{
+		container->MappedRegion.Reset( container->MappedFile->MapRegion( 0, container->MappedFile->GetFileSize() ) );
+	}
+
+	if ( container->MappedRegion && container->MappedRegion->GetMappedSize() <= MAX_int32 )
+	{
+		container->Bytes = TArrayView< const uint8 >( container->MappedRegion->GetMappedPtr(), static_cast< int32 >( container->MappedRegion->GetMappedSize() ) );
+	}
+	else
+	{
+		// Platform save systems that aren't plain files, or platforms that can't map
+		container->MappedRegion.Reset();
+		container->MappedFile.Reset();
+
+		if ( !UGameplayStatics::LoadDataFromSlot( container->OwnedBytes, slotName, 0 ) )
+		{
+			return nullptr;
+		}
+
+		container->Bytes = container->OwnedBytes;
+	}
+
+	if ( !container->Parse() )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Slot {%s} isn't a save container" ), *slotName );
+		return nullptr;
+	}
+
+	if ( container->IsLegacy() || !container->FindSection( JournalSection ) )
+	{
+		return container;
+	}
+
+	if ( bReplayJournal )
+	{
+		container->ApplyJournal( slotName );
+	}
+	else
+	{
+		container->JournalSize = FMath::Max< int64 >( IFileManager::Get().FileSize( *FGameSaveJournal::GetJournalFilePath( slotName ) ), 0 );
+	}
+
+	return container;
+}
+
+USavedGameState* FGameSaveContainer::LoadSave( const FString& slotName, bool bDecodeWorlds )
+{
+	TUniquePtr< FGameSaveContainer > container = Open( slotName );
+	return container ? container->ReadSave( bDecodeWorlds ) : nullptr;
+}
+
+void FGameSaveContainer::EncodeWorld( const FSerializedWorld& world, TArray< uint8 >& outBytes )
+{
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_EncodeWorld );
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveContainer::EncodeWorld );
+
+	outBytes.Reset();
+
+	FMemoryWriter writer( outBytes, true );
+
+	uint32 magic = SaveContainer::WorldMagic;
+	int32 version = SaveContainer::WorldVersion;
+
+	writer << magic;
+	writer << version;
+
+	// Saving only reads the struct, shared worlds are never written to
+	SaveContainer::FWorldArchive worldWriter( writer );
+	FSerializedWorld::StaticStruct()->SerializeItem( worldWriter, const_cast< FSerializedWorld* >( &world ), nullptr );
+
+	// The arena isn't a SaveGame property, so it goes out as one block rather than byte by byte
+	int32 arenaSize = world.ActorArena.Num();
+	writer << arenaSize;
+	writer.Serialize( world.ActorArena.GetData(), arenaSize );
+
+	FGameSerializerTransformCodec::Encode( world, writer );
+}
+
+bool FGameSaveContainer::DecodeWorld( TArrayView< const uint8 > bytes, FSerializedWorld& outWorld, TArray< FString >* outMissingObjects )
+{
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_DecodeWorld );
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveContainer::DecodeWorld );
+
+	FMemoryReaderView reader = SaveContainer::MakeReader( bytes );
+	const int32 version = SaveContainer::ReadWorldVersion( reader );
+
+	if ( reader.IsError() || version < SaveContainer::UnpackedTransformsWorldVersion || version > SaveContainer::WorldVersion )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "World section version %i isn't one this build can read" ), version );
+		return false;
+	}
+
+	SaveContainer::SerializeWorldStruct( reader, FSerializedWorld::StaticStruct(), &outWorld, outMissingObjects );
+
+	// Worlds written before the arena existed end here
+	if ( !reader.IsError() && !reader.AtEnd() )
+	{
+		int32 arenaSize = 0;
+		reader << arenaSize;
+
+		if ( arenaSize < 0 || arenaSize > reader.TotalSize() - reader.Tell() )
+		{
+			return false;
+		}
+
+		outWorld.ActorArena.SetNumUninitialized( arenaSize );
+		reader.Serialize( outWorld.ActorArena.GetData(), arenaSize );
+	}
+
+	// Then the packed transforms, in older sections the records carry them and patches come right after the arena
+	if ( version >= SaveContainer::WorldVersion && !reader.IsError() && !FGameSerializerTransformCodec::Decode( reader, outWorld ) )
+	{
+		return false;
+	}
+
+	// Whatever follows was journaled after the world was written
+	while ( !reader.IsError() && !reader.AtEnd() )
+	{
+		if ( !SaveContainer::ApplyWorldPatch( reader, outWorld, outMissingObjects, version ) )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "A journaled patch doesn't fit its world" ) );
+			return false;
+		}
+	}
+
+	return !reader.IsError();
+}
+
+void FGameSaveContainer::EncodeWorldPatch( const FSerializedWorld& world, int32 baseNames, int32 basePaths, TConstArrayView< int64 > changedActors, TConstArrayView< int64 > removedActors, TArray< uint8 >& outBytes )
+{
+	check( baseNames <= world.References.Names.Num() && basePaths <= world.References.ObjectPaths.Num() );
+
+	FMemoryWriter writer( outBytes, true, true );
+
+	uint32 magic = SaveContainer::PatchMagic;
+	uint8 bLoaded = world.bLoaded ? 1 : 0;
+
+	writer << magic;
+	writer << bLoaded;
+	writer << baseNames;
+	writer << basePaths;
+
+	TArray< FString > names;
+	names.Reserve( world.References.Names.Num() - baseNames );
+
+	for ( int32 index = baseNames; index < world.References.Names.Num(); index++ )
+	{
+		names.Add( world.References.Names[index].ToString() );
+	}
+
+	TArray< FString > paths( world.References.ObjectPaths.GetData() + basePaths, world.References.ObjectPaths.Num() - basePaths );
+	TArray< int64 > removed( removedActors );
+
+	writer << names;
+	writer << paths;
+	writer << removed;
+
+	int32 count = changedActors.Num();
+	writer << count;
+
+	for ( int64 id : changedActors )
+	{
+		// The blob goes after the record, wherever the world keeps it
+		FSerializedActor actor = world.Actors.FindChecked( id );
+		TArrayView< const uint8 > blob = world.GetActorData( actor );
+
+		writer << id;
+
+		actor.Data.Reset();
+		actor.ArenaOffset = INDEX_NONE;
+		actor.ArenaSize = 0;
+		SaveContainer::SerializeStruct( writer, FSerializedActor::StaticStruct(), &actor );
+
+		// Not a SaveGame property, the record keeps its full transform and the codec goes next to it
+		uint8 codec = (uint8)actor.TransformCodec;
+		writer << codec;
+
+		int32 size = blob.Num();
+		writer << size;
+		writer.Serialize( const_cast< uint8* >( blob.GetData() ), size );
+	}
+}
+
+FGameSaveContainer::FGameSaveContainer()
+{
+}
+
+FGameSaveContainer::~FGameSaveContainer()
+{
+	// The region has to go before the file it maps
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FGameSaveContainer::Parse()
+{
+	if ( Bytes.Num() < (int32)sizeof( uint32 ) )
+	{
+		return false;
+	}
+
+	FMemoryReaderView reader = SaveContainer::MakeReader( Bytes );
+
+	uint32 magic = 0;
+	reader << magic;
+
+	if ( magic == SaveContainer::LegacyMagic )
+	{
+		bLegacy = true;
+		return true;
+	}
+
+	int32 version = 0;
+	reader << version;
+
+	if ( magic != SaveContainer::Magic || ( version != SaveContainer::Version && version != SaveContainer::UnversionedWorldsVersion && version != SaveContainer::UncompressedVersion ) )
+	{
+		return false;
+	}
+
+	reader << SaveClassPath;
+
+	if ( version == SaveContainer::UncompressedVersion )
+	{
+		int32 count = 0;
+		reader << count;
+
+		for ( int32 index = 0; index < count && !reader.IsError(); index++ )
+		{
+			FGameSaveContainerSection& section = Sections.AddDefaulted_GetRef();
+			reader << section.Name;
+			reader << section.Offset;
+			reader << section.Size;
+			section.RawSize = section.Size;
+		}
+	}
+	else
+	{
+		reader << Sections;
+	}
+
+	if ( reader.IsError() )
+	{
+		Sections.Reset();
+		return false;
+	}
+
+	for ( const FGameSaveContainerSection& section : Sections )
+	{
+		const bool bBadBlocks = section.IsCompressed() && ( section.BlockSize <= 0 || !FCompression::IsFormatValid( section.Compression ) );
+		const bool bBadRawSize = section.RawSize < 0 || section.RawSize > MAX_int32 || ( !section.IsCompressed() && section.RawSize != section.Size );
+
+		// Compared against what's left past the offset, so a huge size can't overflow its way back into range
+		if ( section.Offset < 0 || section.Size < 0 || section.Offset > Bytes.Num() || section.Size > Bytes.Num() - section.Offset || bBadRawSize || bBadBlocks )
+		{
+			Sections.Reset();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FGameSaveContainer::ApplyJournal( const FString& slotName )
+{
+	if ( !FindSection( JournalSection ) )
+	{
+		return;
+	}
+
+	TArray< uint8 > scratch;
+	FMemoryReaderView reader = SaveContainer::MakeReader( GetStoredSectionData( JournalSection, scratch ) );
+
+	FGuid journalId;
+	int32 journalRecords = 0;
+	reader << journalId;
+
+	// Checkpoints from before journals outlived them only have the id, their journal starts with them
+	if ( !reader.AtEnd() )
+	{
+		reader << journalRecords;
+	}
+
+	TArray< FGameSaveJournalEntry > entries;
+
+	if ( reader.IsError() || !FGameSaveJournal::Read( slotName, journalId, journalRecords, entries, &JournalSize ) )
+	{
+		return;
+	}
+
+	for ( FGameSaveJournalEntry& entry : entries )
+	{
+		FJournaledSection& journaled = JournaledSections.FindOrAdd( entry.Section );
+
+		switch ( entry.Op )
+		{
+		case EGameSaveJournalOp::Replace:
+			journaled = FJournaledSection();
+			journaled.Data = MoveTemp( entry.Data );
+			journaled.bReplaced = true;
+			break;
+		case EGameSaveJournalOp::Patch:
+			journaled.Patches.Append( entry.Data );
+			break;
+		case EGameSaveJournalOp::Remove:
+			journaled = FJournaledSection();
+			journaled.bRemoved = true;
+			break;
+		}
+	}
+
+	// The table of contents lists what the journal added and drops what it removed, replaced sections no longer have a place in the file
+	for ( auto&& keypair : JournaledSections )
+	{
+		const FString& name = keypair.Key;
+
+		if ( keypair.Value.bRemoved )
+		{
+			Sections.RemoveAll( [&name]( const FGameSaveContainerSection& section ) { return section.Name == name; } );
+			continue;
+		}
+
+		if ( !keypair.Value.bReplaced )
+		{
+			continue;
+		}
+
+		FGameSaveContainerSection* section = Sections.FindByPredicate( [&name]( const FGameSaveContainerSection& section ) { return section.Name == name; } );
+
+		if ( !section )
+		{
+			section = &Sections.AddDefaulted_GetRef();
+			section->Name = name;
+		}
+
+		section->Offset = INDEX_NONE;
+		section->Size = keypair.Value.Data.Num();
+		section->RawSize = section->Size;
+		section->Compression = NAME_None;
+		section->BlockSize = 0;
+	}
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Replayed %i journal entries over {%s}, %lld bytes" ), entries.Num(), *slotName, JournalSize );
+}
+
+const FGameSaveContainerSection* FGameSaveContainer::FindSection( const FString& name ) const
+{
+	return Sections.FindByPredicate( [&name]( const FGameSaveContainerSection& section ) { return section.Name == name; } );
+}
+
+TArrayView< const uint8 > FGameSaveContainer::GetSectionData( const FString& name, TArray< uint8 >& scratch ) const
+{
+	const FJournaledSection* journaled = JournaledSections.Find( name );
+
+	if ( !journaled )
+	{
+		return GetStoredSectionData( name, scratch );
+	}
+
+	if ( journaled->bRemoved )
+	{
+		return TArrayView< const uint8 >();
+	}
+
+	if ( journaled->Patches.Num() == 0 )
+	{
+		return journaled->Data;
+	}
+
+	// Patches go after the world they apply to, DecodeWorld picks them up from there
+	TArrayView< const uint8 > base = journaled->bReplaced ? TArrayView< const uint8 >( journaled->Data ) : GetStoredSectionData( name, scratch );
+
+	if ( base.GetData() != scratch.GetData() )
+	{
+		scratch.Reset( base.Num() + journaled->Patches.Num() );
+		scratch.Append( base.GetData(), base.Num() );
+	}
+
+	scratch.Append( journaled->Patches );
+	return scratch;
+}
+
+TArrayView< const uint8 > FGameSaveContainer::GetStoredSectionData( const FString& name, TArray< uint8 >& scratch ) const
+{
+	const FGameSaveContainerSection* section = FindSection( name );
+
+	if ( !section )
+	{
+		return TArrayView< const uint8 >();
+	}
+
+	// Parse made sure the section lies within Bytes, so both fit an int32
+	TArrayView< const uint8 > stored = Bytes.Slice( static_cast< int32 >( section->Offset ), static_cast< int32 >( section->Size ) );
+
+	if ( !section->IsCompressed() )
+	{
+		return stored;
+	}
+
+	const double start = FPlatformTime::Seconds();
+
+	FMemoryReaderView reader = SaveContainer::MakeReader( stored );
+
+	int32 blockCount = 0;
+	reader << blockCount;
+
+	const int64 expectedBlocks = ( section->RawSize + section->BlockSize - 1 ) / section->BlockSize;
+
+	if ( blockCount < 0 || blockCount != expectedBlocks || SaveContainer::GetBlockTableSize( blockCount ) > stored.Num() )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Section %s has a broken block table" ), *name );
+		return TArrayView< const uint8 >();
+	}
+
+	TArray< int64 > blockOffsets;
+	TArray< int32 > blockSizes;
+	blockOffsets.SetNumUninitialized( blockCount );
+	blockSizes.SetNumUninitialized( blockCount );
+
+	int64 offset = SaveContainer::GetBlockTableSize( blockCount );
+
+	for ( int32 block = 0; block < blockCount; block++ )
+	{
+		reader << blockSizes[block];
+
+		if ( blockSizes[block] < 0 )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Section %s has a broken block table" ), *name );
+			return TArrayView< const uint8 >();
+		}
+
+		blockOffsets[block] = offset;
+		offset += blockSizes[block];
+	}
+
+	if ( reader.IsError() || offset > stored.Num() )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Section %s is truncated" ), *name );
+		return TArrayView< const uint8 >();
+	}
+
+	// Parse capped RawSize at MAX_int32
+	scratch.SetNumUninitialized( static_cast< int32 >( section->RawSize ) );
+	TAtomic< bool > bFailed( false );
+
+	ParallelFor( blockCount, [&]( int32 block )
+	{
+		const int64 rawOffset = (int64)block * section->BlockSize;
+		const int32 rawSize = static_cast< int32 >( FMath::Min< int64 >( section->BlockSize, section->RawSize - rawOffset ) );
+
+		if ( !FCompression::UncompressMemory( section->Compression, scratch.GetData() + rawOffset, rawSize, stored.GetData() + blockOffsets[block], blockSizes[block] ) )
+		{
+			bFailed = true;
+		}
+	} );
+
+	ReadStats.RawSize += section->RawSize;
+	ReadStats.StoredSize += section->Size;
+	ReadStats.Seconds += FPlatformTime::Seconds() - start;
+
+	if ( bFailed )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Couldn't decompress section %s" ), *name );
+		scratch.Reset();
+		return TArrayView< const uint8 >();
+	}
+
+	return scratch;
+}
+
+TArray< FName > FGameSaveContainer::GetWorldIds() const
+{
+	TArray< FName > ids;
+
+	for ( const FGameSaveContainerSection& section : Sections )
+	{
+		if ( section.Name.StartsWith( SaveContainer::WorldPrefix, ESearchCase::CaseSensitive ) )
+		{
+			ids.Add( FName( *section.Name.RightChop( FCString::Strlen( SaveContainer::WorldPrefix ) ) ) );
+		}
+	}
+
+	return ids;
+}
+
+USavedGameState* FGameSaveContainer::ReadHeader() const
+{
+	if ( bLegacy )
+	{
+		// Nothing to pick from, the whole thing has to be loaded
+		return ReadSave();
+	}
+
+	UClass* saveClass = FindObject< UClass >( nullptr, *SaveClassPath );
+
+	if ( !saveClass )
+	{
+		saveClass = LoadObject< UClass >( nullptr, *SaveClassPath );
+	}
+
+	if ( !saveClass || !saveClass->IsChildOf( USavedGameState::StaticClass() ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Save class %s is gone, loading the slot as a plain USavedGameState" ), *SaveClassPath );
+		saveClass = USavedGameState::StaticClass();
+	}
+
+	USavedGameState* save = NewObject< USavedGameState >( GetTransientPackage(), saveClass );
+
+	TArray< uint8 > scratch;
+	FMemoryReaderView reader = SaveContainer::MakeReader( GetSectionData( MetadataSection, scratch ) );
+	SaveContainer::FMetadataArchive ar( reader );
+	save->Serialize( ar );
+
+	if ( reader.IsError() )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Couldn't read the save's metadata" ) );
+		return nullptr;
+	}
+
+	return save;
+}
+
+bool FGameSaveContainer::ReadThumbnail( TArray< FColor >& outPixels ) const
+{
+	TArray< uint8 > scratch;
+	TArrayView< const uint8 > data = GetSectionData( ThumbnailSection, scratch );
+
+	outPixels.SetNumUninitialized( data.Num() / sizeof( FColor ) );
+	FMemory::Memcpy( outPixels.GetData(), data.GetData(), outPixels.Num() * sizeof( FColor ) );
+
+	return data.Num() > 0;
+}
+
+bool FGameSaveContainer::ReadWorld( FName worldId, FSerializedWorld& outWorld ) const
+{
+	if ( !FindSection( GetWorldSectionName( worldId ) ) )
+	{
+		return false;
+	}
+
+	TArray< uint8 > scratch;
+	return DecodeWorld( GetSectionData( GetWorldSectionName( worldId ), scratch ), outWorld );
+}
+
+bool FGameSaveContainer::ReadState( FSerializedGameState& outState, bool bDecodeWorlds ) const
+{
+	if ( bLegacy )
+	{
+		USavedGameState* save = ReadSave();
+
+		if ( save )
+		{
+			outState = MoveTemp( save->SavedState );
+		}
+
+		return save != nullptr;
+	}
+
+	outState = FSerializedGameState();
+
+	for ( FName worldId : GetWorldIds() )
+	{
+		if ( !bDecodeWorlds )
+		{
+			// Copied out rather than pointing into the mapping, the slot file gets rewritten while the game runs
+			TSharedRef< TArray< uint8 >, ESPMode::ThreadSafe > encoded = MakeShared< TArray< uint8 >, ESPMode::ThreadSafe >();
+			TArrayView< const uint8 > data = GetSectionData( GetWorldSectionName( worldId ), *encoded );
+
+			if ( data.GetData() != encoded->GetData() )
+			{
+				encoded->Append( data.GetData(), data.Num() );
+			}
+
+			outState.EncodedWorlds.Add( worldId, encoded );
+			continue;
+		}
+
+		if ( !ReadWorld( worldId, outState.Worlds.Add( worldId ) ) )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Couldn't read world %s from the save" ), *worldId.ToString() );
+			return false;
+		}
+	}
+
+	{
+		TArray< uint8 > scratch;
+		FMemoryReaderView reader = SaveContainer::MakeReader( GetSectionData( PersistentObjectsSection, scratch ) );
+
+		int32 count = 0;
+		reader << count;
+
+		for ( int32 index = 0; index < count && !reader.IsError(); index++ )
+		{
+			FString id;
+			reader << id;
+			SaveContainer::SerializeStruct( reader, FSerializedGameObject::StaticStruct(), &outState.PersistentObjects.Add( FName( *id ) ) );
+		}
+
+		if ( reader.IsError() )
+		{
+			return false;
+		}
+	}
+
+	{
+		TArray< uint8 > scratch;
+		FMemoryReaderView reader = SaveContainer::MakeReader( GetSectionData( PlayerStateSection, scratch ) );
+		SaveContainer::SerializeStruct( reader, FSerializedActor::StaticStruct(), &outState.SavedPlayerState );
+
+		if ( reader.IsError() )
+		{
+			return false;
+		}
+	}
+
+	{
+		TArray< uint8 > scratch;
+		FMemoryReaderView reader = SaveContainer::MakeReader( GetSectionData( ReferencesSection, scratch ) );
+		SaveContainer::SerializeStruct( reader, FGameSerializerReferenceTable::StaticStruct(), &outState.References );
+
+		if ( reader.IsError() )
+		{
+			return false;
+		}
+	}
+
+	if ( FindSection( LevelsSection ) )
+	{
+		TArray< uint8 > scratch;
+		FMemoryReaderView reader = SaveContainer::MakeReader( GetSectionData( LevelsSection, scratch ) );
+		reader << outState.LevelWorldIds;
+	}
+
+	return true;
+}
+
+USavedGameState* FGameSaveContainer::ReadSave( bool bDecodeWorlds ) const
+{
+	if ( bLegacy )
+	{
+		if ( IsMapped() )
+		{
+			return Cast< USavedGameState >( UGameplayStatics::LoadGameFromMemory( TArray< uint8 >( Bytes.GetData(), Bytes.Num() ) ) );
+		}
+
+		return Cast< USavedGameState >( UGameplayStatics::LoadGameFromMemory( OwnedBytes ) );
+	}
+
+	USavedGameState* save = ReadHeader();
+
+	if ( !save )
+	{
+		return nullptr;
+	}
+
+	ReadThumbnail( save->ScreenshotPixels );
+
+	if ( !ReadState( save->SavedState, bDecodeWorlds ) )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Save state is corrupt" ) );
+		return nullptr;
+	}
+
+	if ( ReadStats.RawSize > 0 )
+	{
+		UE_LOG( LogSaveGame, Log, TEXT( "Decompressed save sections: %lld -> %lld bytes in %.2f ms" ), ReadStats.StoredSize, ReadStats.RawSize, ReadStats.Seconds * 1000.0 );
+	}
+
+	return save;
+}
@@ -0,0 +1,711 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameSaveJournal.h"
+
+#include "Classes.h"
+#include "GameSaveContainer.h"
+#include "GameSerializer.h"
+#include "GameSerializerSettings.h"
+#include "GameSerializerStats.h"
+#include "SaveGameManifest.h"
+
+#include "Async/Async.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace SaveJournal
+{
+	static const uint32 Magic = 0x4E4A5347; // "GSJN"
+	static const int32 Version = 2;
+
+	/** Journals that started with their checkpoint, before the header had the index of its first record. */
+	static const int32 CheckpointBoundVersion = 1;
+
+	/** Starts a record, followed by the payload size and the payload. */
+	static const uint32 RecordMagic = 0x524A5347; // "GSJR"
+
+	/** Ends a record after the payload's CRC, a record only counts once this made it to disk. */
+	static const uint32 CommitMagic = 0x434A5347; // "GSJC"
+
+	static const int64 RecordHeaderSize = sizeof( uint32 ) + sizeof( int32 );
+	static const int64 RecordFooterSize = sizeof( uint32 ) * 2;
+
+	static uint64 HashBytes( TArrayView< const uint8 > bytes, uint64 seed = 0 )
+	{
+		return CityHash64WithSeed( reinterpret_cast< const char* >( bytes.GetData() ), bytes.Num(), seed );
+	}
+
+	/** Covers everything a world patch writes for the actor, class pointers are fine since the hashes never leave the session. */
+	static uint64 HashActor( const FSerializedWorld& world, const FSerializedActor& actor )
+	{
+		const FTransform& transform = actor.ActorTransform;
+		const FVector location = transform.GetLocation();
+		const FQuat rotation = transform.GetRotation();
+		const FVector scale = transform.GetScale3D();
+
+		const double values[] =
+		{
+			location.X, location.Y, location.Z,
+			rotation.X, rotation.Y, rotation.Z, rotation.W,
+			scale.X, scale.Y, scale.Z,
+		};
+
+		const uint64 fields[] =
+		{
+			reinterpret_cast< UPTRINT >( actor.ActorClass.Get() ),
+			GetTypeHash( actor.AttachmentPoint ),
+			(uint64)actor.bWasSpawned | ( (uint64)actor.bUsesReferenceTable << 1 ) | ( (uint64)actor.Encoding << 2 ) | ( (uint64)actor.TransformCodec << 10 ),
+		};
+
+		uint64 hash = HashBytes( world.GetActorData( actor ) );
+		hash = CityHash64WithSeed( reinterpret_cast< const char* >( values ), sizeof( values ), hash );
+		return CityHash64WithSeed( reinterpret_cast< const char* >( fields ), sizeof( fields ), hash );
+	}
+
+	/** Patches index into the table the world had, so it can only grow at the end between records. */
+	static bool ExtendsTable( const FGameSerializerReferenceTable& table, const TArray< FName >& names, const TArray< FString >& paths )
+	{
+		if ( table.Names.Num() < names.Num() || table.ObjectPaths.Num() < paths.Num() )
+		{
+			return false;
+		}
+
+		for ( int32 index = 0; index < names.Num(); index++ )
+		{
+			if ( table.Names[index] != names[index] )
+			{
+				return false;
+			}
+		}
+
+		for ( int32 index = 0; index < paths.Num(); index++ )
+		{
+			if ( table.ObjectPaths[index] != paths[index] )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** firstRecord is the index of the journal's first record, the ones before it were compacted into the checkpoint. */
+	static TArray< uint8 > MakeHeader( const FGuid& journalId, int32 firstRecord )
+	{
+		TArray< uint8 > header;
+		FMemoryWriter writer( header, true );
+
+		uint32 magic = Magic;
+		int32 version = Version;
+		FGuid id = journalId;
+
+		writer << magic;
+		writer << version;
+		writer << id;
+		writer << firstRecord;
+
+		return header;
+	}
+
+	static void SerializeEntry( FArchive& Ar, FGameSaveJournalEntry& entry )
+	{
+		uint8 op = (uint8)entry.Op;
+		Ar << op;
+		Ar << entry.Section;
+		Ar << entry.Data;
+
+		entry.Op = (EGameSaveJournalOp)op;
+	}
+}
+
+FGameSaveJournal::FGameSaveJournal( const FString& slotName )
+	: SlotName( slotName )
+{
+}
+
+FGameSaveJournal::~FGameSaveJournal()
+{
+	if ( Compaction.IsValid() )
+	{
+		Compaction.Wait();
+	}
+}
+
+FString FGameSaveJournal::GetJournalFilePath( const FString& slotName )
+{
+	return FPaths::ProjectSavedDir() / TEXT( "SaveGames" ) / slotName + TEXT( ".journal" );
+}
+
+bool FGameSaveJournal::Read( const FString& slotName, const FGuid& journalId, int32 checkpointRecords, TArray< FGameSaveJournalEntry >& outEntries, int64* outSize )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveJournal::Read );
+
+	const FString path = GetJournalFilePath( slotName );
+	FGameSaveContainer::RecoverFile( path );
+
+	TArray< uint8 > bytes;
+
+	if ( !FFileHelper::LoadFileToArray( bytes, *path, FILEREAD_Silent ) )
+	{
+		return false;
+	}
+
+	FMemoryReader reader( bytes, true );
+
+	uint32 magic = 0;
+	int32 version = 0;
+	FGuid fileId;
+	int32 firstRecord = 0;
+
+	reader << magic;
+	reader << version;
+	reader << fileId;
+
+	if ( version == SaveJournal::Version )
+	{
+		reader << firstRecord;
+	}
+
+	if ( reader.IsError() || magic != SaveJournal::Magic || ( version != SaveJournal::Version && version != SaveJournal::CheckpointBoundVersion ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Journal of {%s} is unreadable, loading the checkpoint alone" ), *slotName );
+		return false;
+	}
+
+	// Left over from an older checkpoint, the crash happened between writing the checkpoint and starting its journal
+	if ( fileId != journalId )
+	{
+		UE_LOG( LogSaveGame, Log, TEXT( "Journal of {%s} belongs to another checkpoint, ignoring it" ), *slotName );
+		return false;
+	}
+
+	// A journal newer than the checkpoint still has the records the checkpoint holds, a compaction moved the slot but didn't trim it yet.
+	// Records the checkpoint lacks can only be missing if the slot was put back from somewhere else.
+	const int32 skipped = checkpointRecords - firstRecord;
+
+	if ( skipped < 0 )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Journal of {%s} starts at record %i past its checkpoint's %i, loading the checkpoint alone" ), *slotName, firstRecord, checkpointRecords );
+		return false;
+	}
+
+	int64 committed = reader.Tell();
+	int32 records = 0;
+
+	while ( bytes.Num() - reader.Tell() >= SaveJournal::RecordHeaderSize )
+	{
+		uint32 recordMagic = 0;
+		int32 size = 0;
+
+		reader << recordMagic;
+		reader << size;
+
+		if ( recordMagic != SaveJournal::RecordMagic || size < 0 || size > bytes.Num() - reader.Tell() - SaveJournal::RecordFooterSize )
+		{
+			break;
+		}
+
+		const TArrayView< const uint8 > payload( bytes.GetData() + reader.Tell(), size );
+		reader.Seek( reader.Tell() + size );
+
+		uint32 crc = 0;
+		uint32 commit = 0;
+
+		reader << crc;
+		reader << commit;
+
+		if ( reader.IsError() || commit != SaveJournal::CommitMagic || crc != FCrc::MemCrc32( payload.GetData(), payload.Num() ) )
+		{
+			break;
+		}
+
+		FMemoryReaderView payloadReader( FMemoryView( payload.GetData(), payload.Num() ), true );
+
+		int32 count = 0;
+		payloadReader << count;
+
+		TArray< FGameSaveJournalEntry > entries;
+
+		for ( int32 index = 0; index < count && !payloadReader.IsError(); index++ )
+		{
+			SaveJournal::SerializeEntry( payloadReader, entries.AddDefaulted_GetRef() );
+		}
+
+		if ( payloadReader.IsError() )
+		{
+			break;
+		}
+
+		if ( records >= skipped )
+		{
+			outEntries.Append( MoveTemp( entries ) );
+		}
+
+		committed = reader.Tell();
+		records++;
+	}
+
+	if ( committed < bytes.Num() )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Journal of {%s} ends in %lld uncommitted bytes, ignoring them" ), *slotName, bytes.Num() - committed );
+	}
+
+	if ( outSize )
+	{
+		*outSize = committed;
+	}
+
+	UE_LOG( LogSaveGame, Verbose, TEXT( "Read %i journal records of {%s}, %i of them already in the checkpoint" ), records, *slotName, FMath::Min( records, skipped ) );
+	return true;
+}
+
+void FGameSaveJournal::Delete( const FString& slotName )
+{
+	IFileManager::Get().Delete( *GetJournalFilePath( slotName ), false, false, true );
+	IFileManager::Get().Delete( *( GetJournalFilePath( slotName ) + TEXT( ".tmp" ) ), false, false, true );
+}
+
+int64 FGameSaveJournal::GetJournalSize() const
+{
+	FScopeLock lock( &Lock );
+	return JournalSize;
+}
+
+bool FGameSaveJournal::Write( USavedGameState* save, FGameSaveSlotInfo* outInfo, int64* outBytesWritten )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveJournal::Write );
+
+	if ( !save )
+	{
+		return false;
+	}
+
+	const bool bCanAppend = JournalId.IsValid();
+
+	TArray< FGameSaveJournalEntry > entries;
+	TMap< FString, uint64 > sections;
+	TMap< FName, FWorldBaseline > worlds;
+	FDeltaStats stats;
+
+	BuildDelta( save, bCanAppend ? &entries : nullptr, sections, worlds, stats );
+
+	if ( !bCanAppend )
+	{
+		if ( !WriteCheckpoint( save, outInfo, outBytesWritten ) )
+		{
+			return false;
+		}
+
+		Sections = MoveTemp( sections );
+		Worlds = MoveTemp( worlds );
+		return true;
+	}
+
+	TArray< uint8 > record;
+
+	{
+		FMemoryWriter writer( record, true );
+
+		uint32 recordMagic = SaveJournal::RecordMagic;
+		int32 size = 0;
+
+		writer << recordMagic;
+		writer << size;
+
+		int32 count = entries.Num();
+		writer << count;
+
+		for ( FGameSaveJournalEntry& entry : entries )
+		{
+			SaveJournal::SerializeEntry( writer, entry );
+		}
+
+		size = record.Num() - SaveJournal::RecordHeaderSize;
+		uint32 crc = FCrc::MemCrc32( record.GetData() + SaveJournal::RecordHeaderSize, size );
+		uint32 commit = SaveJournal::CommitMagic;
+
+		writer << crc;
+		writer << commit;
+
+		writer.Seek( sizeof( uint32 ) );
+		writer << size;
+	}
+
+	bool bAppended = false;
+	int64 journalSize = 0;
+	int64 checkpointSize = 0;
+
+	{
+		FScopeLock lock( &Lock );
+		bAppended = AppendFile( record );
+
+		if ( bAppended )
+		{
+			JournalSize += record.Num();
+			RecordCount++;
+
+			if ( entries.ContainsByPredicate( []( const FGameSaveJournalEntry& entry ) { return entry.Section == FGameSaveContainer::ThumbnailSection; } ) )
+			{
+				ThumbnailRecord = RecordCount - 1;
+				ThumbnailOffset = INDEX_NONE;
+				ThumbnailSize = 0;
+			}
+
+			if ( outInfo )
+			{
+				outInfo->FileSize = CheckpointSize + JournalSize;
+				outInfo->UncompressedSize = CheckpointRawSize + JournalSize;
+				outInfo->ThumbnailOffset = ThumbnailOffset;
+				outInfo->ThumbnailSize = ThumbnailSize;
+			}
+
+			journalSize = JournalSize;
+			checkpointSize = CheckpointSize;
+		}
+	}
+
+	if ( !bAppended )
+	{
+		// Part of the record may have made it, nothing can be appended behind it anymore
+		UE_LOG( LogSaveGame, Warning, TEXT( "Couldn't append to the journal of {%s}, writing a checkpoint" ), *SlotName );
+		JournalId.Invalidate();
+
+		if ( !WriteCheckpoint( save, outInfo, outBytesWritten ) )
+		{
+			return false;
+		}
+
+		Sections = MoveTemp( sections );
+		Worlds = MoveTemp( worlds );
+		return true;
+	}
+
+	Sections = MoveTemp( sections );
+	Worlds = MoveTemp( worlds );
+
+	if ( outBytesWritten )
+	{
+		*outBytesWritten = record.Num();
+	}
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Journaled {%s}: %i sections, %i worlds patched, %i actors changed, %i removed, %i bytes (journal %lld, checkpoint %lld)" ),
+		*SlotName, stats.Sections, stats.PatchedWorlds, stats.ChangedActors, stats.RemovedActors, record.Num(), journalSize, checkpointSize );
+
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	const int64 maxBytes = settings ? (int64)settings->JournalCompactionKB * 1024 : 0;
+	const int64 maxRatioBytes = settings ? (int64)( settings->JournalCompactionRatio * checkpointSize ) : 0;
+
+	// The save already counts as written, folding the journal into a checkpoint can take its time.
+	// Saves keep appending while it runs, the next one over the limits after it finished starts another.
+	if ( journalSize > FMath::Min( maxBytes, maxRatioBytes ) && !IsCompacting() )
+	{
+		UE_LOG( LogSaveGame, Log, TEXT( "Journal of {%s} grew to %lld bytes over a %lld byte checkpoint, compacting" ), *SlotName, journalSize, checkpointSize );
+		StartCompaction( save );
+	}
+
+	return true;
+}
+
+void FGameSaveJournal::BuildDelta( USavedGameState* save, TArray< FGameSaveJournalEntry >* outEntries, TMap< FString, uint64 >& outSections, TMap< FName, FWorldBaseline >& outWorlds, FDeltaStats& outStats ) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveJournal::BuildDelta );
+
+	auto addEntry = [outEntries, &outStats]( EGameSaveJournalOp op, const FString& section ) -> TArray< uint8 >&
+	{
+		FGameSaveJournalEntry& entry = outEntries->AddDefaulted_GetRef();
+		entry.Op = op;
+		entry.Section = section;
+		outStats.Sections++;
+		return entry.Data;
+	};
+
+	// Everything that isn't a world is small, it goes in whole when it changed
+	TArray< FString > names;
+	TArray< TArray< uint8 > > payloads;
+	FGameSaveContainer::BuildSections( save, false, names, payloads );
+
+	for ( int32 index = 0; index < names.Num(); index++ )
+	{
+		const uint64 hash = SaveJournal::HashBytes( payloads[index] );
+		const uint64* previous = Sections.Find( names[index] );
+
+		if ( outEntries && ( !previous || *previous != hash ) )
+		{
+			addEntry( EGameSaveJournalOp::Replace, names[index] ) = MoveTemp( payloads[index] );
+		}
+
+		outSections.Add( names[index], hash );
+	}
+
+	if ( outEntries )
+	{
+		for ( auto&& keypair : Sections )
+		{
+			if ( !outSections.Contains( keypair.Key ) )
+			{
+				addEntry( EGameSaveJournalOp::Remove, keypair.Key );
+			}
+		}
+	}
+
+	const FSerializedGameState& state = save->SavedState;
+
+	state.ForEachDecodedWorld( [this, outEntries, &outWorlds, &outStats, &addEntry]( FName worldId, const FSerializedWorld& world )
+	{
+		FWorldBaseline& baseline = outWorlds.Add( worldId );
+
+		baseline.bLoaded = world.bLoaded;
+		baseline.Names = world.References.Names;
+		baseline.ObjectPaths = world.References.ObjectPaths;
+		baseline.Actors.Reserve( world.Actors.Num() );
+
+		for ( auto&& actor : world.Actors )
+		{
+			baseline.Actors.Add( actor.Key, SaveJournal::HashActor( world, actor.Value ) );
+		}
+
+		if ( !outEntries )
+		{
+			return;
+		}
+
+		const FString section = FGameSaveContainer::GetWorldSectionName( worldId );
+		const FWorldBaseline* previous = Worlds.Find( worldId );
+
+		// Worlds that were written encoded, or whose table started over, go in whole
+		if ( !previous || previous->bEncoded || !SaveJournal::ExtendsTable( world.References, previous->Names, previous->ObjectPaths ) )
+		{
+			FGameSaveContainer::EncodeWorld( world, addEntry( EGameSaveJournalOp::Replace, section ) );
+			return;
+		}
+
+		TArray< int64 > changed;
+		TArray< int64 > removed;
+
+		for ( auto&& actor : baseline.Actors )
+		{
+			const uint64* hash = previous->Actors.Find( actor.Key );
+
+			if ( !hash || *hash != actor.Value )
+			{
+				changed.Add( actor.Key );
+			}
+		}
+
+		for ( auto&& actor : previous->Actors )
+		{
+			if ( !baseline.Actors.Contains( actor.Key ) )
+			{
+				removed.Add( actor.Key );
+			}
+		}
+
+		const bool bTableGrew = baseline.Names.Num() != previous->Names.Num() || baseline.ObjectPaths.Num() != previous->ObjectPaths.Num();
+
+		if ( changed.Num() == 0 && removed.Num() == 0 && !bTableGrew && baseline.bLoaded == previous->bLoaded )
+		{
+			return;
+		}
+
+		FGameSaveContainer::EncodeWorldPatch( world, previous->Names.Num(), previous->ObjectPaths.Num(), changed, removed, addEntry( EGameSaveJournalOp::Patch, section ) );
+
+		outStats.PatchedWorlds++;
+		outStats.ChangedActors += changed.Num();
+		outStats.RemovedActors += removed.Num();
+	} );
+
+	for ( auto&& keypair : state.EncodedWorlds )
+	{
+		if ( !keypair.Value.IsValid() || state.FindDecodedWorld( keypair.Key ) )
+		{
+			continue;
+		}
+
+		FWorldBaseline& baseline = outWorlds.Add( keypair.Key );
+		baseline.bEncoded = true;
+		baseline.Encoded = keypair.Value;
+
+		const FWorldBaseline* previous = Worlds.Find( keypair.Key );
+
+		if ( outEntries && ( !previous || !previous->bEncoded || previous->Encoded.Pin() != keypair.Value ) )
+		{
+			addEntry( EGameSaveJournalOp::Replace, FGameSaveContainer::GetWorldSectionName( keypair.Key ) ) = *keypair.Value;
+		}
+	}
+
+	if ( outEntries )
+	{
+		for ( auto&& keypair : Worlds )
+		{
+			if ( !outWorlds.Contains( keypair.Key ) )
+			{
+				addEntry( EGameSaveJournalOp::Remove, FGameSaveContainer::GetWorldSectionName( keypair.Key ) );
+			}
+		}
+	}
+}
+
+bool FGameSaveJournal::WriteCheckpoint( USavedGameState* save, FGameSaveSlotInfo* outInfo, int64* outBytesWritten )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveJournal::WriteCheckpoint );
+
+	// Both would move a checkpoint over the slot, and the running one would trim the new journal
+	if ( Compaction.IsValid() )
+	{
+		Compaction.Wait();
+		Compaction = TFuture< void >();
+	}
+
+	const FGuid journalId = FGuid::NewGuid();
+
+	FGameSaveSlotInfo info;
+	TArray< uint8 > bytes;
+
+	if ( !FGameSaveContainer::Write( save, bytes, &info, nullptr, journalId ) )
+	{
+		return false;
+	}
+
+	// The old journal doesn't match the new checkpoint, it's ignored from here on even if we crash before replacing it
+	JournalId.Invalidate();
+
+	// Journals go next to the slot file, platform save systems that keep slots elsewhere only ever get checkpoints
+	const bool bFileBacked = FGameSaveContainer::IsSlotFileBacked();
+
+	if ( bFileBacked ? !FGameSaveContainer::ReplaceFile( FGameSaveContainer::GetSlotFilePath( SlotName ), bytes ) : !UGameplayStatics::SaveDataToSlot( bytes, SlotName, 0 ) )
+	{
+		return false;
+	}
+
+	if ( outInfo )
+	{
+		outInfo->FileSize = info.FileSize;
+		outInfo->UncompressedSize = info.UncompressedSize;
+		outInfo->ThumbnailOffset = info.ThumbnailOffset;
+		outInfo->ThumbnailSize = info.ThumbnailSize;
+	}
+
+	if ( outBytesWritten )
+	{
+		*outBytesWritten = bytes.Num();
+	}
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Wrote checkpoint {%s}! File size: %i bytes" ), *SlotName, bytes.Num() );
+
+	if ( !bFileBacked )
+	{
+		UE_LOG( LogSaveGame, Verbose, TEXT( "Slot {%s} isn't a plain file, it won't be journaled" ), *SlotName );
+		return true;
+	}
+
+	const TArray< uint8 > header = SaveJournal::MakeHeader( journalId, 0 );
+
+	if ( !FGameSaveContainer::ReplaceFile( GetJournalFilePath( SlotName ), header ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Couldn't start a journal for {%s}, the next save writes a checkpoint again" ), *SlotName );
+		return true;
+	}
+
+	FScopeLock lock( &Lock );
+
+	JournalId = journalId;
+	RecordCount = 0;
+	ThumbnailRecord = INDEX_NONE;
+	CheckpointSize = bytes.Num();
+	CheckpointRawSize = info.UncompressedSize;
+	ThumbnailOffset = info.ThumbnailOffset;
+	ThumbnailSize = info.ThumbnailSize;
+	JournalSize = header.Num();
+
+	return true;
+}
+
+void FGameSaveJournal::StartCompaction( USavedGameState* save )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveJournal::StartCompaction );
+
+	// Only this needs the save object, it's cleared once the save is written
+	TArray< FString > names;
+	TArray< TArray< uint8 > > payloads;
+	FGameSaveContainer::BuildSections( save, true, names, payloads );
+
+	int32 journalRecords = 0;
+	int64 journalOffset = 0;
+
+	{
+		FScopeLock lock( &Lock );
+		journalRecords = RecordCount;
+		journalOffset = JournalSize;
+	}
+
+	// The destructor and WriteCheckpoint wait for it, so this outlives the task
+	Compaction = Async( EAsyncExecution::ThreadPool, [this, saveClassPath = save->GetClass()->GetPathName(), names = MoveTemp( names ), payloads = MoveTemp( payloads ), journalId = JournalId, journalRecords, journalOffset]() mutable
+	{
+		Compact( saveClassPath, MoveTemp( names ), MoveTemp( payloads ), journalId, journalRecords, journalOffset );
+	} );
+}
+
+void FGameSaveJournal::Compact( const FString& saveClassPath, TArray< FString > names, TArray< TArray< uint8 > > payloads, const FGuid& journalId, int32 journalRecords, int64 journalOffset )
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE( FGameSaveJournal::Compact );
+
+	FGameSaveSlotInfo info;
+	TArray< uint8 > bytes;
+
+	// The checkpoint notes the records it holds, replay skips them in the journal until it's trimmed below
+	if ( !FGameSaveContainer::WriteSections( saveClassPath, MoveTemp( names ), MoveTemp( payloads ), bytes, &info, nullptr, journalId, journalRecords )
+		|| !FGameSaveContainer::ReplaceFile( FGameSaveContainer::GetSlotFilePath( SlotName ), bytes ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Couldn't compact the journal of {%s}, it keeps growing until the next try" ), *SlotName );
+		return;
+	}
+
+	FScopeLock lock( &Lock );
+
+	CheckpointSize = bytes.Num();
+	CheckpointRawSize = info.UncompressedSize;
+
+	// Records past the checkpoint may have replaced the thumbnail again
+	if ( ThumbnailRecord < journalRecords )
+	{
+		ThumbnailOffset = info.ThumbnailOffset;
+		ThumbnailSize = info.ThumbnailSize;
+	}
+
+	const FString path = GetJournalFilePath( SlotName );
+	TArray< uint8 > journal;
+	TArray< uint8 > trimmed = SaveJournal::MakeHeader( journalId, journalRecords );
+
+	// Only what was committed is carried over, JournalSize ends at the last record we appended
+	const bool bRead = FFileHelper::LoadFileToArray( journal, *path, FILEREAD_Silent ) && journal.Num() >= JournalSize && journalOffset <= JournalSize;
+
+	if ( bRead )
+	{
+		trimmed.Append( journal.GetData() + journalOffset, static_cast< int32 >( JournalSize - journalOffset ) );
+	}
+
+	if ( !bRead || !FGameSaveContainer::ReplaceFile( path, trimmed ) )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Compacted {%s} into a %i byte checkpoint but couldn't trim its journal, replay skips what the checkpoint holds" ), *SlotName, bytes.Num() );
+		return;
+	}
+
+	JournalSize = trimmed.Num();
+
+	UE_LOG( LogSaveGame, Log, TEXT( "Compacted {%s} into a %i byte checkpoint, %lld journal bytes left" ), *SlotName, bytes.Num(), JournalSize );
+}
+
+bool FGameSaveJournal::AppendFile( const TArray< uint8 >& bytes ) const
+{
+	TUniquePtr< IFileHandle > file( FPlatformFileManager::Get().GetPlatformFile().OpenWrite( *GetJournalFilePath( SlotName ), true ) );
+
+	// The flush is what makes the commit marker count, a record the disk doesn't have yet isn't committed
+	return file && file->Write( bytes.GetData(), bytes.Num() ) && file->Flush( true );
+}
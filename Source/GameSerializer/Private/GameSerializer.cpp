@@ -1,21 +1,53 @@
 // Copyright 1998-2018 Epic Games, Inc. All Rights Reserved.
 
 #include "GameSerializer.h"
+#include "GameSerializerStats.h"
+#include "SerializationSchema.h"
 
 #define LOCTEXT_NAMESPACE "FGameSerializerModule"
 
 void FGameSerializerModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	FGameSerializerClassSchema::RegisterInvalidationHooks();
 }
 
 void FGameSerializerModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FGameSerializerClassSchema::UnregisterInvalidationHooks();
 }
 
 #undef LOCTEXT_NAMESPACE
 
 DEFINE_LOG_CATEGORY(LogSaveGame);
+DEFINE_LOG_CATEGORY(LogSaveGameDetail);
+
+DEFINE_STAT( STAT_GameSerializer_Gather );
+DEFINE_STAT( STAT_GameSerializer_CaptureWorld );
+DEFINE_STAT( STAT_GameSerializer_SerializeActor );
+DEFINE_STAT( STAT_GameSerializer_SerializeObject );
+DEFINE_STAT( STAT_GameSerializer_WriteSave );
+DEFINE_STAT( STAT_GameSerializer_LoadSave );
+DEFINE_STAT( STAT_GameSerializer_EncodeWorld );
+DEFINE_STAT( STAT_GameSerializer_DecodeWorld );
+DEFINE_STAT( STAT_GameSerializer_RestoreWorld );
+DEFINE_STAT( STAT_GameSerializer_LoadActor );
+DEFINE_STAT( STAT_GameSerializer_LoadObject );
+DEFINE_STAT( STAT_GameSerializer_SpawnActor );
+DEFINE_STAT( STAT_GameSerializer_PostDataLoaded );
+DEFINE_STAT( STAT_GameSerializer_ActorsSerialized );
+DEFINE_STAT( STAT_GameSerializer_ActorsReused );
+DEFINE_STAT( STAT_GameSerializer_ActorsShared );
+DEFINE_STAT( STAT_GameSerializer_DedupRatio );
+DEFINE_STAT( STAT_GameSerializer_SaveBytes );
+
+CSV_DEFINE_CATEGORY_MODULE( GAMESERIALIZER_API, GameSerializer, true );
+
+LLM_DEFINE_TAG( GameSerializer );
+LLM_DEFINE_TAG( GameSerializer_Capture, TEXT( "Capture" ), TEXT( "GameSerializer" ) );
+LLM_DEFINE_TAG( GameSerializer_SaveFile, TEXT( "SaveFile" ), TEXT( "GameSerializer" ) );
+LLM_DEFINE_TAG( GameSerializer_WorldState, TEXT( "WorldState" ), TEXT( "GameSerializer" ) );
+LLM_DEFINE_TAG( GameSerializer_Restore, TEXT( "Restore" ), TEXT( "GameSerializer" ) );
 IMPLEMENT_MODULE(FGameSerializerModule, GameSerializer)
\ No newline at end of file
@@ -1,3 +1,199 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
-#include "GameSerializerArchive.h"
\ No newline at end of file
+#include "GameSerializerArchive.h"
+
+#include "Serialization/ArchiveUObject.h"
+#include "UObject/SoftObjectPtr.h"
+
+FGameSerializerReferenceTable::FGameSerializerReferenceTable( const FGameSerializerReferenceTable& other )
+	:Names( other.Names ),
+	ObjectPaths( other.ObjectPaths )
+{
+}
+
+FGameSerializerReferenceTable& FGameSerializerReferenceTable::operator=( const FGameSerializerReferenceTable& other )
+{
+	if ( this != &other )
+	{
+		Reset();
+		Names = other.Names;
+		ObjectPaths = other.ObjectPaths;
+	}
+
+	return *this;
+}
+
+int32 FGameSerializerReferenceTable::AddName( FName name )
+{
+	BuildLookups();
+
+	if ( const int32* existing = NameLookup.Find( name ) )
+	{
+		return *existing;
+	}
+
+	const int32 index = Names.Add( name );
+	NameLookup.Add( name, index );
+	return index;
+}
+
+int32 FGameSerializerReferenceTable::AddObject( UObject* object )
+{
+	check( object );
+	BuildLookups();
+
+	// Most references repeat, so the path only gets built the first time we see an object
+	if ( const int32* existing = ObjectLookup.Find( FObjectKey( object ) ) )
+	{
+		return *existing;
+	}
+
+	FString path = object->GetPathName();
+	int32 index = INDEX_NONE;
+
+	if ( const int32* samePath = PathLookup.Find( path ) )
+	{
+		index = *samePath;
+	}
+	else
+	{
+		index = ObjectPaths.Add( path );
+		PathLookup.Add( MoveTemp( path ), index );
+	}
+
+	ObjectLookup.Add( FObjectKey( object ), index );
+	return index;
+}
+
+UObject* FGameSerializerReferenceTable::ResolveObject( int32 index )
+{
+	if ( !ObjectPaths.IsValidIndex( index ) )
+	{
+		return nullptr;
+	}
+
+	if ( ResolvedObjects.Num() != ObjectPaths.Num() )
+	{
+		ResolvedObjects.SetNum( ObjectPaths.Num() );
+	}
+
+	// Objects that weren't loaded yet, or were collected since, get looked up again
+	UObject* object = ResolvedObjects[index].Get();
+
+	if ( !object )
+	{
+		object = FindObject< UObject >( nullptr, *ObjectPaths[index], false );
+		ResolvedObjects[index] = object;
+	}
+
+	return object;
+}
+
+void FGameSerializerReferenceTable::Reset()
+{
+	Names.Reset();
+	ObjectPaths.Reset();
+	NameLookup.Reset();
+	ObjectLookup.Reset();
+	PathLookup.Reset();
+	ResolvedObjects.Reset();
+}
+
+SIZE_T FGameSerializerReferenceTable::GetAllocatedSize() const
+{
+	SIZE_T size = Names.GetAllocatedSize() + ObjectPaths.GetAllocatedSize() + ResolvedObjects.GetAllocatedSize();
+	size += NameLookup.GetAllocatedSize() + ObjectLookup.GetAllocatedSize() + PathLookup.GetAllocatedSize();
+
+	for ( const FString& path : ObjectPaths )
+	{
+		size += path.GetAllocatedSize();
+	}
+
+	for ( auto&& keypair : PathLookup )
+	{
+		size += keypair.Key.GetAllocatedSize();
+	}
+
+	return size;
+}
+
+void FGameSerializerReferenceTable::BuildLookups()
+{
+	if ( NameLookup.Num() != Names.Num() )
+	{
+		NameLookup.Reset();
+
+		for ( int32 x = 0; x < Names.Num(); x++ )
+		{
+			NameLookup.Add( Names[x], x );
+		}
+	}
+
+	if ( PathLookup.Num() != ObjectPaths.Num() )
+	{
+		PathLookup.Reset();
+
+		for ( int32 x = 0; x < ObjectPaths.Num(); x++ )
+		{
+			PathLookup.Add( ObjectPaths[x], x );
+		}
+	}
+}
+
+FArchive& FGameSerializerTableArchive::operator<<( FName& N )
+{
+	// 0 is reserved for NAME_None, everything else is index + 1
+	uint32 packed = 0;
+
+	if ( IsLoading() )
+	{
+		InnerArchive.SerializeIntPacked( packed );
+		N = packed == 0 ? NAME_None : Table.GetName( (int32)packed - 1 );
+	}
+	else
+	{
+		packed = N.IsNone() ? 0 : (uint32)Table.AddName( N ) + 1;
+		InnerArchive.SerializeIntPacked( packed );
+	}
+
+	return *this;
+}
+
+FArchive& FGameSerializerTableArchive::operator<<( UObject*& Obj )
+{
+	// 0 is reserved for null, everything else is index + 1
+	uint32 packed = 0;
+
+	if ( IsLoading() )
+	{
+		InnerArchive.SerializeIntPacked( packed );
+		Obj = packed == 0 ? nullptr : Table.ResolveObject( (int32)packed - 1 );
+	}
+	else
+	{
+		packed = Obj ? (uint32)Table.AddObject( Obj ) + 1 : 0;
+		InnerArchive.SerializeIntPacked( packed );
+	}
+
+	return *this;
+}
+
+FArchive& FGameSerializerTableArchive::operator<<( FWeakObjectPtr& Obj )
+{
+	return FArchiveUObject::SerializeWeakObject( *this, Obj );
+}
+
+FArchive& FGameSerializerTableArchive::operator<<( FSoftObjectPtr& Value )
+{
+	return FArchiveUObject::SerializeSoftObjectPtr( *this, Value );
+}
+
+FArchive& FGameSerializerTableArchive::operator<<( FSoftObjectPath& Value )
+{
+	return FArchiveUObject::SerializeSoftObjectPath( *this, Value );
+}
+
+FArchive& FGameSerializerTableArchive::operator<<( FObjectPtr& Obj )
+{
+	return FArchiveUObject::SerializeObjectPtr( *this, Obj );
+}
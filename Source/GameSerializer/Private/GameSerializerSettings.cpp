@@ -5,4 +5,27 @@
 UGameSerializerSettings::UGameSerializerSettings()
 {
 	SaveClass = USavedGameState::StaticClass();
+	ReferenceMode = EGameSerializerReferenceMode::ReferenceTable;
+	bUseCompiledSchemas = false;
+	bDeltaEncoding = false;
+	bIncrementalCapture = false;
+	RestoreBudgetMs = 0.f;
+	CaptureBudgetMs = 2.f;
+	bWriteSavesAsync = true;
+	Compression = EGameSerializerCompression::LZ4;
+	CompressionBlockSizeKB = 256;
+	bJournalSaves = false;
+	JournalCompactionKB = 8192;
+	JournalCompactionRatio = 0.5f;
+	DefaultTransformCodec = EGameSerializerTransformCodec::Full;
+	TransformQuantizationStep = 0.1f;
+	bAutosave = false;
+	AutosaveIntervalSeconds = 300.f;
+	AutosaveMinSpacingSeconds = 60.f;
+	AutosaveSlot = -1;
+	bAmortizeAutosave = true;
+	AutosaveFrameBudgetMs = 16.6f;
+	AutosaveHeadroomMs = 4.f;
+	AutosaveCheapFrames = 5;
+	AutosaveMaxDeferralSeconds = 60.f;
 }
\ No newline at end of file
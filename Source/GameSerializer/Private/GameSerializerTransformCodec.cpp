@@ -0,0 +1,473 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameSerializerTransformCodec.h"
+
+#include "GameSerializer.h"
+#include "GameSerializerSettings.h"
+
+namespace SaveTransforms
+{
+	static const uint32 Magic = 0x54575347; // "GSWT"
+	static const uint8 Version = 1;
+
+	/** Per actor flags: the codec in the low two bits, then whether the scale was left out, then which quaternion component was dropped. */
+	static const uint8 CodecMask = 0x03;
+	static const uint8 IdentityScaleFlag = 0x04;
+	static const int32 DroppedComponentShift = 3;
+
+	/** The three smallest components of a unit quaternion lie within +-1/sqrt(2), this spreads them over the whole int16 range. */
+	static const double RotationScale = 32767.0 * 1.4142135623730951;
+
+	static const double RotationTolerance = 1.e-4;
+
+	static_assert( sizeof( FIntVector ) == 3 * sizeof( int32 ), "Quantized locations are converted as a flat array of int32" );
+
+	/** The transforms of a world by codec, one entry per actor of that codec in the order they iterate in. */
+	struct FTransformArrays
+	{
+		TArray< FVector3d > FullLocations;
+		TArray< FQuat4d > FullRotations;
+		TArray< FVector3d > FullScales;
+
+		/** Relative to the block's origin. */
+		TArray< FVector3f > FloatLocations;
+		TArray< FQuat4f > FloatRotations;
+
+		/** Steps from the block's origin. */
+		TArray< FIntVector > QuantizedLocations;
+
+		/** Three per actor, the dropped component's index is in the actor's flags. */
+		TArray< int16 > QuantizedRotations;
+
+		/** Scales of Float and Quantized actors alike, only those that aren't identity. */
+		TArray< FVector3f > FloatScales;
+	};
+
+	/** Components one at a time, so the archive swaps their bytes where it has to. */
+	static void SerializeElement( FArchive& Ar, uint8& value ) { Ar << value; }
+	static void SerializeElement( FArchive& Ar, int16& value ) { Ar << value; }
+	static void SerializeElement( FArchive& Ar, FVector3d& value ) { Ar << value.X << value.Y << value.Z; }
+	static void SerializeElement( FArchive& Ar, FVector3f& value ) { Ar << value.X << value.Y << value.Z; }
+	static void SerializeElement( FArchive& Ar, FQuat4d& value ) { Ar << value.X << value.Y << value.Z << value.W; }
+	static void SerializeElement( FArchive& Ar, FQuat4f& value ) { Ar << value.X << value.Y << value.Z << value.W; }
+	static void SerializeElement( FArchive& Ar, FIntVector& value ) { Ar << value.X << value.Y << value.Z; }
+
+	template< typename ElementType >
+	static void SerializeArray( FArchive& Ar, TArray< ElementType >& values )
+	{
+		int32 count = values.Num();
+		Ar << count;
+
+		if ( Ar.IsLoading() )
+		{
+			if ( Ar.IsError() || count < 0 || (int64)count * sizeof( ElementType ) > Ar.TotalSize() - Ar.Tell() )
+			{
+				Ar.SetError();
+				return;
+			}
+
+			values.SetNumUninitialized( count );
+		}
+
+		for ( ElementType& value : values )
+		{
+			SerializeElement( Ar, value );
+		}
+	}
+
+	static void SerializeArrays( FArchive& Ar, FTransformArrays& arrays )
+	{
+		SerializeArray( Ar, arrays.FullLocations );
+		SerializeArray( Ar, arrays.FullRotations );
+		SerializeArray( Ar, arrays.FullScales );
+		SerializeArray( Ar, arrays.FloatLocations );
+		SerializeArray( Ar, arrays.FloatRotations );
+		SerializeArray( Ar, arrays.QuantizedLocations );
+		SerializeArray( Ar, arrays.QuantizedRotations );
+		SerializeArray( Ar, arrays.FloatScales );
+	}
+
+	/** Appends the three smallest components of the rotation to outSmallest, returns the index of the one left out. */
+	static int32 DropLargestComponent( const FQuat& rotation, TArray< double >& outSmallest )
+	{
+		const FQuat normalized = rotation.GetNormalized();
+		const double components[4] = { normalized.X, normalized.Y, normalized.Z, normalized.W };
+
+		int32 dropped = 0;
+
+		for ( int32 index = 1; index < 4; index++ )
+		{
+			if ( FMath::Abs( components[index] ) > FMath::Abs( components[dropped] ) )
+			{
+				dropped = index;
+			}
+		}
+
+		// q and -q are the same rotation, with the dropped component positive it can be rebuilt from the other three
+		const double sign = components[dropped] < 0.0 ? -1.0 : 1.0;
+
+		for ( int32 index = 0; index < 4; index++ )
+		{
+			if ( index != dropped )
+			{
+				outSmallest.Add( components[index] * sign );
+			}
+		}
+
+		return dropped;
+	}
+
+	static FQuat RestoreLargestComponent( const double* smallest, int32 dropped )
+	{
+		double components[4];
+		double sum = 0.0;
+
+		for ( int32 index = 0, source = 0; index < 4; index++ )
+		{
+			if ( index != dropped )
+			{
+				components[index] = smallest[source++];
+				sum += components[index] * components[index];
+			}
+		}
+
+		components[dropped] = FMath::Sqrt( FMath::Max( 1.0 - sum, 0.0 ) );
+
+		return FQuat( components[0], components[1], components[2], components[3] ).GetNormalized();
+	}
+}
+
+EGameSerializerTransformCodec FGameSerializerTransformCodec::Resolve( const AActor* actor, TMap< TObjectKey< UClass >, EGameSerializerTransformCodec >& classCache )
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	if ( !settings || !actor )
+	{
+		return EGameSerializerTransformCodec::Full;
+	}
+
+	for ( const FName& tag : actor->Tags )
+	{
+		if ( const EGameSerializerTransformCodec* codec = settings->TransformCodecsByTag.Find( tag ) )
+		{
+			return *codec;
+		}
+	}
+
+	if ( const EGameSerializerTransformCodec* cached = classCache.Find( actor->GetClass() ) )
+	{
+		return *cached;
+	}
+
+	EGameSerializerTransformCodec codec = settings->DefaultTransformCodec;
+	const UClass* closest = nullptr;
+
+	for ( auto&& keypair : settings->TransformCodecsByClass )
+	{
+		// Classes that aren't loaded have no instances to capture
+		const UClass* codecClass = keypair.Key.Get();
+
+		if ( codecClass && actor->IsA( codecClass ) && ( !closest || codecClass->IsChildOf( closest ) ) )
+		{
+			closest = codecClass;
+			codec = keypair.Value;
+		}
+	}
+
+	classCache.Add( actor->GetClass(), codec );
+	return codec;
+}
+
+bool FGameSerializerTransformCodec::Matches( const FTransform& a, const FTransform& b, EGameSerializerTransformCodec codec, double quantizationStep )
+{
+	double locationTolerance = KINDA_SMALL_NUMBER;
+
+	if ( codec == EGameSerializerTransformCodec::Float )
+	{
+		// Single precision a few kilometers from the world's origin
+		locationTolerance = 0.01;
+	}
+	else if ( codec == EGameSerializerTransformCodec::Quantized )
+	{
+		// Encode coarsens the step for large worlds, the one it stored is what the location was rounded to
+		if ( quantizationStep <= 0.0 )
+		{
+			UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+			quantizationStep = settings ? (double)settings->TransformQuantizationStep : 0.1;
+		}
+
+		locationTolerance = FMath::Max( quantizationStep, locationTolerance );
+	}
+
+	return a.GetLocation().Equals( b.GetLocation(), locationTolerance )
+		&& a.GetRotation().Equals( b.GetRotation(), SaveTransforms::RotationTolerance )
+		&& a.GetScale3D().Equals( b.GetScale3D(), KINDA_SMALL_NUMBER );
+}
+
+void FGameSerializerTransformCodec::Encode( const FSerializedWorld& world, FArchive& Ar )
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	double step = FMath::Max( settings ? (double)settings->TransformQuantizationStep : 0.1, 0.001 );
+
+	// Relative locations are taken from the middle of the actors that store them, which keeps them small
+	FBox bounds( ForceInit );
+
+	for ( auto&& keypair : world.Actors )
+	{
+		if ( keypair.Value.TransformCodec != EGameSerializerTransformCodec::Full )
+		{
+			bounds += keypair.Value.ActorTransform.GetLocation();
+		}
+	}
+
+	FVector origin = FVector::ZeroVector;
+
+	if ( bounds.IsValid )
+	{
+		origin = bounds.GetCenter();
+
+		// Quantized offsets have to fit an int32, worlds too big for the step get a coarser one
+		step = FMath::Max( step, bounds.GetExtent().GetMax() / ( MAX_int32 / 2 ) );
+	}
+
+	TArray< uint8 > flags;
+	flags.Reserve( world.Actors.Num() );
+
+	SaveTransforms::FTransformArrays arrays;
+	TArray< double > offsets;
+	TArray< double > smallest;
+
+	// Split the records into flat arrays by codec
+	for ( auto&& keypair : world.Actors )
+	{
+		const FSerializedActor& actor = keypair.Value;
+		const FTransform& transform = actor.ActorTransform;
+		const bool bIdentityScale = transform.GetScale3D().Equals( FVector::OneVector );
+
+		uint8 flag = (uint8)actor.TransformCodec & SaveTransforms::CodecMask;
+		flag |= bIdentityScale ? SaveTransforms::IdentityScaleFlag : 0;
+
+		switch ( actor.TransformCodec )
+		{
+		case EGameSerializerTransformCodec::Float:
+			arrays.FloatLocations.Add( FVector3f( transform.GetLocation() - origin ) );
+			arrays.FloatRotations.Add( FQuat4f( transform.GetRotation() ) );
+			break;
+
+		case EGameSerializerTransformCodec::Quantized:
+		{
+			const FVector offset = transform.GetLocation() - origin;
+			offsets.Append( { offset.X, offset.Y, offset.Z } );
+			flag |= (uint8)( SaveTransforms::DropLargestComponent( transform.GetRotation(), smallest ) << SaveTransforms::DroppedComponentShift );
+			break;
+		}
+
+		default:
+			flag = (uint8)( ( flag & ~SaveTransforms::CodecMask ) | (uint8)EGameSerializerTransformCodec::Full );
+			arrays.FullLocations.Add( transform.GetLocation() );
+			arrays.FullRotations.Add( transform.GetRotation() );
+
+			if ( !bIdentityScale )
+			{
+				arrays.FullScales.Add( transform.GetScale3D() );
+			}
+
+			break;
+		}
+
+		if ( !bIdentityScale && ( flag & SaveTransforms::CodecMask ) != (uint8)EGameSerializerTransformCodec::Full )
+		{
+			arrays.FloatScales.Add( FVector3f( transform.GetScale3D() ) );
+		}
+
+		flags.Add( flag );
+	}
+
+	// Quantize in flat passes over plain arrays, simple enough for the compiler to vectorize
+	const double inverseStep = 1.0 / step;
+
+	arrays.QuantizedLocations.SetNumUninitialized( offsets.Num() / 3 );
+	int32* quantized = reinterpret_cast< int32* >( arrays.QuantizedLocations.GetData() );
+
+	for ( int32 index = 0; index < offsets.Num(); index++ )
+	{
+		quantized[index] = (int32)FMath::RoundToDouble( offsets[index] * inverseStep );
+	}
+
+	arrays.QuantizedRotations.SetNumUninitialized( smallest.Num() );
+
+	for ( int32 index = 0; index < smallest.Num(); index++ )
+	{
+		arrays.QuantizedRotations[index] = (int16)FMath::Clamp( FMath::RoundToDouble( smallest[index] * SaveTransforms::RotationScale ), -32767.0, 32767.0 );
+	}
+
+	uint32 magic = SaveTransforms::Magic;
+	uint8 version = SaveTransforms::Version;
+	int32 count = world.Actors.Num();
+
+	Ar << magic;
+	Ar << version;
+	Ar << count;
+	Ar << origin.X << origin.Y << origin.Z;
+	Ar << step;
+
+	SaveTransforms::SerializeArray( Ar, flags );
+	SaveTransforms::SerializeArrays( Ar, arrays );
+}
+
+bool FGameSerializerTransformCodec::Decode( FArchive& Ar, FSerializedWorld& world )
+{
+	const int64 start = Ar.Tell();
+
+	if ( Ar.TotalSize() - start < (int64)sizeof( uint32 ) )
+	{
+		return true;
+	}
+
+	uint32 magic = 0;
+	Ar << magic;
+
+	// Worlds written before transforms were packed keep them in their records
+	if ( magic != SaveTransforms::Magic )
+	{
+		Ar.Seek( start );
+		return true;
+	}
+
+	uint8 version = 0;
+	int32 count = 0;
+	FVector origin = FVector::ZeroVector;
+	double step = 0.0;
+
+	Ar << version;
+	Ar << count;
+	Ar << origin.X << origin.Y << origin.Z;
+	Ar << step;
+
+	if ( Ar.IsError() || version > SaveTransforms::Version || count != world.Actors.Num() )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Packed transforms (version %i) for %i actors don't fit a world of %i" ), version, count, world.Actors.Num() );
+		return false;
+	}
+
+	TArray< uint8 > flags;
+	SaveTransforms::FTransformArrays arrays;
+
+	SaveTransforms::SerializeArray( Ar, flags );
+	SaveTransforms::SerializeArrays( Ar, arrays );
+
+	if ( Ar.IsError() || flags.Num() != count
+		|| arrays.FullRotations.Num() != arrays.FullLocations.Num()
+		|| arrays.FloatRotations.Num() != arrays.FloatLocations.Num()
+		|| arrays.QuantizedRotations.Num() != arrays.QuantizedLocations.Num() * 3 )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Packed transforms are corrupt" ) );
+		return false;
+	}
+
+	// Every entry of the arrays has to belong to exactly one actor
+	int32 counts[3] = { 0, 0, 0 };
+	int32 fullScales = 0;
+	int32 floatScales = 0;
+
+	for ( uint8 flag : flags )
+	{
+		const uint8 codec = flag & SaveTransforms::CodecMask;
+		const bool bScale = ( flag & SaveTransforms::IdentityScaleFlag ) == 0;
+
+		if ( codec >= UE_ARRAY_COUNT( counts ) )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Packed transforms use a codec this build doesn't know" ) );
+			return false;
+		}
+
+		// Only quantized rotations drop a component, and it has to be one of the quaternion's four
+		const uint8 dropped = flag >> SaveTransforms::DroppedComponentShift;
+
+		if ( codec == (uint8)EGameSerializerTransformCodec::Quantized ? dropped >= 4 : dropped != 0 )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Packed transforms are corrupt" ) );
+			return false;
+		}
+
+		counts[codec]++;
+		fullScales += bScale && codec == (uint8)EGameSerializerTransformCodec::Full ? 1 : 0;
+		floatScales += bScale && codec != (uint8)EGameSerializerTransformCodec::Full ? 1 : 0;
+	}
+
+	if ( counts[(uint8)EGameSerializerTransformCodec::Full] != arrays.FullLocations.Num() || fullScales != arrays.FullScales.Num()
+		|| counts[(uint8)EGameSerializerTransformCodec::Float] != arrays.FloatLocations.Num() || floatScales != arrays.FloatScales.Num()
+		|| counts[(uint8)EGameSerializerTransformCodec::Quantized] != arrays.QuantizedLocations.Num() )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Packed transforms don't match their flags" ) );
+		return false;
+	}
+
+	// Dequantize in flat passes, the same way they were quantized
+	TArray< double > offsets;
+	offsets.SetNumUninitialized( arrays.QuantizedLocations.Num() * 3 );
+	const int32* quantized = reinterpret_cast< const int32* >( arrays.QuantizedLocations.GetData() );
+
+	for ( int32 index = 0; index < offsets.Num(); index++ )
+	{
+		offsets[index] = quantized[index] * step;
+	}
+
+	TArray< double > smallest;
+	smallest.SetNumUninitialized( arrays.QuantizedRotations.Num() );
+
+	for ( int32 index = 0; index < smallest.Num(); index++ )
+	{
+		smallest[index] = arrays.QuantizedRotations[index] / SaveTransforms::RotationScale;
+	}
+
+	int32 full = 0;
+	int32 fullScale = 0;
+	int32 single = 0;
+	int32 singleScale = 0;
+	int32 quantizedIndex = 0;
+	int32 index = 0;
+
+	for ( auto&& keypair : world.Actors )
+	{
+		FSerializedActor& actor = keypair.Value;
+		const uint8 flag = flags[index++];
+		const bool bIdentityScale = ( flag & SaveTransforms::IdentityScaleFlag ) != 0;
+
+		FVector location;
+		FQuat rotation;
+		FVector scale = FVector::OneVector;
+
+		actor.TransformCodec = (EGameSerializerTransformCodec)( flag & SaveTransforms::CodecMask );
+
+		switch ( actor.TransformCodec )
+		{
+		case EGameSerializerTransformCodec::Full:
+			location = arrays.FullLocations[full];
+			rotation = arrays.FullRotations[full++];
+			scale = bIdentityScale ? scale : arrays.FullScales[fullScale++];
+			break;
+
+		case EGameSerializerTransformCodec::Float:
+			location = origin + FVector( arrays.FloatLocations[single] );
+			rotation = FQuat( arrays.FloatRotations[single++] );
+			break;
+
+		case EGameSerializerTransformCodec::Quantized:
+			location = origin + FVector( offsets[quantizedIndex * 3], offsets[quantizedIndex * 3 + 1], offsets[quantizedIndex * 3 + 2] );
+			rotation = SaveTransforms::RestoreLargestComponent( &smallest[quantizedIndex * 3], flag >> SaveTransforms::DroppedComponentShift );
+			quantizedIndex++;
+			break;
+		}
+
+		if ( actor.TransformCodec != EGameSerializerTransformCodec::Full && !bIdentityScale )
+		{
+			scale = FVector( arrays.FloatScales[singleScale++] );
+		}
+
+		actor.ActorTransform = FTransform( rotation, location, scale );
+	}
+
+	world.TransformStep = quantizedIndex > 0 ? step : 0.0;
+	return true;
+}
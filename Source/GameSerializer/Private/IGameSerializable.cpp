@@ -6,6 +6,6 @@
 // Add default functionality here for any ISerializable functions that are not pure virtual.
 void IGameSerializable::PostDataLoaded_Implementation()
 {
-    UE_LOG(LogSaveGame, Warning, TEXT( "Post serialize!" ));
+    UE_LOG(LogSaveGameDetail, Verbose, TEXT( "Post serialize!" ));
     DataLoaded();
 }
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SaveGameManifest.h"
+
+#include "Classes.h"
+
+#include "Kismet/GameplayStatics.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace SaveManifest
+{
+	static const uint32 Magic = 0x4D534753; // "SGSM"
+	static const int32 Version = 2;
+}
+
+void FGameSaveSlotInfo::CopyFromSave( const USavedGameState* save )
+{
+	check( save );
+
+	TimeOfSave = save->TimeOfSave;
+	SavedTime = save->SavedTime;
+	SavedMap = save->SavedMap;
+	ScreenshotSizeX = save->ScreenshotSizeX;
+	ScreenshotSizeY = save->ScreenshotSizeY;
+}
+
+void FGameSaveSlotInfo::ApplyToSave( USavedGameState* save ) const
+{
+	check( save );
+
+	save->TimeOfSave = TimeOfSave;
+	save->SavedTime = SavedTime;
+	save->SavedMap = SavedMap;
+	save->ScreenshotSizeX = ScreenshotSizeX;
+	save->ScreenshotSizeY = ScreenshotSizeY;
+	save->bHeaderOnly = true;
+}
+
+FArchive& operator<<( FArchive& Ar, FGameSaveSlotInfo& info )
+{
+	Ar << info.SlotIndex;
+	Ar << info.SlotName;
+	Ar << info.TimeOfSave;
+	Ar << info.SavedTime;
+	Ar << info.SavedMap;
+	Ar << info.FileSize;
+	Ar << info.UncompressedSize;
+	Ar << info.ScreenshotSizeX;
+	Ar << info.ScreenshotSizeY;
+	Ar << info.ThumbnailOffset;
+	Ar << info.ThumbnailSize;
+
+	return Ar;
+}
+
+bool FGameSaveManifest::Load( const FString& prefix )
+{
+	Reset();
+
+	TArray< uint8 > bytes;
+
+	if ( !UGameplayStatics::LoadDataFromSlot( bytes, GetManifestSlotName( prefix ), 0 ) )
+	{
+		return false;
+	}
+
+	FMemoryReader reader( bytes, true );
+
+	uint32 magic = 0;
+	int32 version = 0;
+	reader << magic;
+	reader << version;
+
+	if ( magic != SaveManifest::Magic || version != SaveManifest::Version )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "Ignoring save manifest with unknown format for prefix {%s}" ), *prefix );
+		return false;
+	}
+
+	reader << Slots;
+
+	if ( reader.IsError() )
+	{
+		Reset();
+		return false;
+	}
+
+	bLoaded = true;
+	return true;
+}
+
+bool FGameSaveManifest::Save( const FString& prefix ) const
+{
+	TArray< uint8 > bytes;
+	FMemoryWriter writer( bytes, true );
+
+	uint32 magic = SaveManifest::Magic;
+	int32 version = SaveManifest::Version;
+	writer << magic;
+	writer << version;
+	writer << const_cast< TArray< FGameSaveSlotInfo >& >( Slots );
+
+	return UGameplayStatics::SaveDataToSlot( bytes, GetManifestSlotName( prefix ), 0 );
+}
+
+const FGameSaveSlotInfo* FGameSaveManifest::Find( int32 slotIndex ) const
+{
+	return Slots.FindByPredicate( [slotIndex]( const FGameSaveSlotInfo& info ) { return info.SlotIndex == slotIndex; } );
+}
+
+void FGameSaveManifest::Update( const FGameSaveSlotInfo& info )
+{
+	if ( FGameSaveSlotInfo* existing = const_cast< FGameSaveSlotInfo* >( Find( info.SlotIndex ) ) )
+	{
+		*existing = info;
+		return;
+	}
+
+	Slots.Add( info );
+	Slots.Sort( []( const FGameSaveSlotInfo& a, const FGameSaveSlotInfo& b ) { return a.SlotIndex < b.SlotIndex; } );
+}
+
+void FGameSaveManifest::Reset()
+{
+	Slots.Reset();
+	bLoaded = false;
+}
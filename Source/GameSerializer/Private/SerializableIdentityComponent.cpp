@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SerializableIdentityComponent.h"
+
+USerializableIdentityComponent::USerializableIdentityComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	PersistentId = 0;
+}
+
+void USerializableIdentityComponent::OnComponentCreated()
+{
+	Super::OnComponentCreated();
+	EnsureId();
+}
+
+void USerializableIdentityComponent::PostDuplicate( EDuplicateMode::Type DuplicateMode )
+{
+	Super::PostDuplicate( DuplicateMode );
+
+	// A copy is a new actor, PIE duplicates the world and must keep the ids of the placed actors
+	if ( DuplicateMode == EDuplicateMode::Normal )
+	{
+		PersistentId = 0;
+		EnsureId();
+	}
+}
+
+#if WITH_EDITOR
+void USerializableIdentityComponent::PostEditImport()
+{
+	Super::PostEditImport();
+
+	// Pasted actors are new actors too
+	PersistentId = 0;
+	EnsureId();
+}
+#endif
+
+int64 USerializableIdentityComponent::GenerateId()
+{
+	const FGuid guid = FGuid::NewGuid();
+	const uint64 id = ( ( (uint64)guid.A << 32 ) | guid.B ) ^ ( ( (uint64)guid.C << 32 ) | guid.D );
+
+	return id != 0 ? (int64)id : 1;
+}
+
+void USerializableIdentityComponent::EnsureId()
+{
+	if ( PersistentId == 0 && !HasAnyFlags( RF_ClassDefaultObject | RF_ArchetypeObject ) )
+	{
+		PersistentId = GenerateId();
+	}
+}
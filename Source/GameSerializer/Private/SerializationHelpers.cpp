@@ -15,23 +15,124 @@
 #include "Serialization/MemoryWriter.h"
 #include "GameSerializer/Public/GameSerializerArchive.h"
 #include "GameSerializer/Public/IGameSerializable.h"
+#include "GameSerializer/Public/GameSerializerSettings.h"
+#include "GameSerializer/Public/SerializationSchema.h"
+#include "GameSerializer/Public/SerializableIdentityComponent.h"
+#include "GameSerializer/Public/GameSerializerStats.h"
+#include "Hash/CityHash.h"
+#include "Misc/StringBuilder.h"
+
+namespace SerializerArchives
+{
+	/** Runs func with the save game archive matching the table, names as strings when there is none. */
+	template< typename FuncType >
+	static void WithArchive( FArchive& inner, FGameSerializerReferenceTable* references, FuncType&& func )
+	{
+		if ( references )
+		{
+			FGameSerializerTableArchive Ar( inner, *references );
+			func( Ar );
+		}
+		else
+		{
+			FGameSerializerArchive Ar( inner );
+			func( Ar );
+		}
+	}
+
+	static EGameSerializerBlobEncoding GetSaveEncoding( const UObject* object )
+	{
+		UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+		if ( !settings || !settings->bUseCompiledSchemas )
+		{
+			return EGameSerializerBlobEncoding::Tagged;
+		}
+
+		// Schemas only see SaveGame properties, whatever a native Serialize override writes besides them would be lost
+		for ( const TSoftClassPtr< UObject >& taggedClass : settings->TaggedEncodingClasses )
+		{
+			// Classes that aren't loaded have no instances to save
+			const UClass* loaded = taggedClass.Get();
+
+			if ( loaded && object->IsA( loaded ) )
+			{
+				return EGameSerializerBlobEncoding::Tagged;
+			}
+		}
+
+		return settings->bDeltaEncoding ? EGameSerializerBlobEncoding::Delta : EGameSerializerBlobEncoding::Schema;
+	}
+
+	/**
+	 * Saves or loads the object's SaveGame data in the given encoding, returns false if the blob doesn't match the class anymore.
+	 * Delta blobs are taken against the archetype snapshot if there is one, the class defaults otherwise.
+	 */
+	static bool SerializeObject( FArchive& Ar, UObject* object, EGameSerializerBlobEncoding encoding, const FGameSerializerSnapshot* archetype = nullptr )
+	{
+		if ( encoding == EGameSerializerBlobEncoding::Schema || encoding == EGameSerializerBlobEncoding::Delta )
+		{
+			TSharedRef< const FGameSerializerClassSchema > schema = FGameSerializerClassSchema::Get( object->GetClass() );
+
+			uint32 hash = schema->GetHash();
+			Ar << hash;
+
+			if ( Ar.IsLoading() && hash != schema->GetHash() )
+			{
+				UE_LOG( LogSaveGame, Error, TEXT( "Save data for %s was written with a different property layout, skipping it" ), *object->GetName() );
+				return false;
+			}
+
+			if ( encoding == EGameSerializerBlobEncoding::Delta )
+			{
+				return schema->SerializeDelta( Ar, object, archetype );
+			}
+
+			schema->Serialize( Ar, object );
+			return true;
+		}
+
+		object->Serialize( Ar );
+		return true;
+	}
+
+	/** Appends the actor's blob to buffer and fills in the rest of the save, returns where the blob starts. */
+	static int32 WriteActor( AActor* actor, FGameSerializerReferenceTable* references, TArray< uint8 >& buffer, FSerializedActor& save, const FGameSerializerSnapshot* archetype )
+	{
+		SCOPE_CYCLE_COUNTER( STAT_GameSerializer_SerializeActor );
+		GAMESERIALIZER_TRACE_SCOPE( TEXT( "SerializeActor %s" ), *actor->GetClass()->GetName() );
+
+		const int32 start = buffer.Num();
+
+		FMemoryWriter MemoryWriter( buffer );
+		MemoryWriter.Seek( start );
+
+		save.Encoding = GetSaveEncoding( actor );
+		WithArchive( MemoryWriter, references, [actor, &save, archetype]( FArchive& Ar ) { SerializeObject( Ar, actor, save.Encoding, archetype ); } );
+
+		save.bUsesReferenceTable = references != nullptr;
+		save.bWasSpawned = !actor->bNetStartup;
+		save.ActorClass = actor->GetClass();
+		save.ActorTransform = actor->GetTransform();
+		save.UniqueId = *actor->GetName();
+		save.Fingerprint = (int32)FCrc::MemCrc32( buffer.GetData() + start, buffer.Num() - start );
+
+		return start;
+	}
+}
 
 FSerializedActor USerializationHelpers::SaveActor(AActor* actor)
+{
+	return SaveActor( actor, nullptr );
+}
+
+FSerializedActor USerializationHelpers::SaveActor( AActor* actor, FGameSerializerReferenceTable* references )
 {
 	ensure( actor );
 
 	if ( !actor ) { return FSerializedActor::Null(); }
 
 	auto save = FSerializedActor();
-	FMemoryWriter MemoryWriter(save.Data);
-	FGameSerializerArchive Ar(MemoryWriter);
-
-	actor->Serialize( Ar );
-
-	save.bWasSpawned = !actor->bNetStartup;
-	save.ActorClass = actor->GetClass();
-	save.ActorTransform = actor->GetTransform();
-	save.UniqueId = *actor->GetName();
+	SerializerArchives::WriteActor( actor, references, save.Data, save, nullptr );
 	//try
 	//{
 	//	actor->Serialize(Ar);
@@ -44,42 +145,112 @@ FSerializedActor USerializationHelpers::SaveActor(AActor* actor)
 	return save;
 }
 
+FSerializedActor USerializationHelpers::SaveActor( AActor* actor, FGameSerializerReferenceTable* references, TArray< uint8 >& arena, const FGameSerializerSnapshot* archetype )
+{
+	ensure( actor );
+
+	if ( !actor ) { return FSerializedActor::Null(); }
+
+	FSerializedActor save;
+	save.ArenaOffset = SerializerArchives::WriteActor( actor, references, arena, save, archetype );
+	save.ArenaSize = arena.Num() - save.ArenaOffset;
+
+	return save;
+}
+
 FSerializedGameObject USerializationHelpers::SaveObject( UObject * object )
 {
+	return SaveObject( object, nullptr );
+}
+
+FSerializedGameObject USerializationHelpers::SaveObject( UObject* object, FGameSerializerReferenceTable* references )
+{
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_SerializeObject );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "SerializeObject %s" ), *object->GetClass()->GetName() );
+
 	FSerializedGameObject save = FSerializedGameObject();
 	FMemoryWriter MemoryWriter( save.Data );
-	FGameSerializerArchive Ar( MemoryWriter );
 
-	object->Serialize( Ar );
+	save.Encoding = SerializerArchives::GetSaveEncoding( object );
+	SerializerArchives::WithArchive( MemoryWriter, references, [object, &save]( FArchive& Ar ) { SerializerArchives::SerializeObject( Ar, object, save.Encoding ); } );
 
+	save.bUsesReferenceTable = references != nullptr;
 	save.UniqueId = *object->GetName();
 	save.ObjectClass = object->GetClass();
 
-	UE_LOG( LogSaveGame, Warning, TEXT( "Saved object %s" ), *object->GetPathName() );
+	UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Saved object %s" ), *object->GetPathName() );
 	return save;
 }
 
-void USerializationHelpers::LoadActor(AActor* actor, FSerializedActor save)
+void USerializationHelpers::LoadActor(AActor* actor, const FSerializedActor& save)
+{
+	LoadActor( actor, save, nullptr );
+}
+
+void USerializationHelpers::LoadActor( AActor* actor, const FSerializedActor& save, FGameSerializerReferenceTable* references )
+{
+	if ( save.ArenaOffset != INDEX_NONE )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Save for %s lives in its world's arena, load it with LoadActorFromWorld or detach it first" ), actor ? *actor->GetName() : TEXT( "None" ) );
+		return;
+	}
+
+	LoadActor( actor, save, save.Data, references );
+}
+
+bool USerializationHelpers::LoadActor( AActor* actor, const FSerializedActor& save, FSerializedWorld& world, const FGameSerializerSnapshot* archetype, bool bNotify )
+{
+	return LoadActor( actor, save, world.GetActorData( save ), &world.References, archetype, bNotify );
+}
+
+bool USerializationHelpers::LoadActorFromWorld( AActor* actor, FSerializedWorld& world, int64 actorId )
+{
+	const FSerializedActor* save = world.Actors.Find( actorId );
+
+	if ( !save )
+	{
+		UE_LOG( LogSaveGame, Warning, TEXT( "World has no actor %lld" ), actorId );
+		return false;
+	}
+
+	return LoadActor( actor, *save, world );
+}
+
+bool USerializationHelpers::LoadActor( AActor* actor, const FSerializedActor& save, TArrayView< const uint8 > data, FGameSerializerReferenceTable* references, const FGameSerializerSnapshot* archetype, bool bNotify )
 {
 	ensure( actor );
 
 	if (actor == nullptr)
 	{
 		UE_LOG(LogSaveGame, Error, TEXT("Do not try to save/load null actors!"));
-		return;
+		return false;
 	}
 
-	FMemoryReader MemoryReader( save.Data, true );
-	FGameSerializerArchive Ar( MemoryReader );
+	if ( save.bUsesReferenceTable && !references )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Can't load %s without the reference table it was saved with!" ), *actor->GetName() );
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_LoadActor );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "LoadActor %s" ), *actor->GetClass()->GetName() );
+
+	FMemoryReaderView MemoryReader( FMemoryView( data.GetData(), data.Num() ), true );
 
-	actor->Serialize( Ar );
+	bool bLoaded = false;
+	SerializerArchives::WithArchive( MemoryReader, save.bUsesReferenceTable ? references : nullptr, [actor, &save, archetype, &bLoaded]( FArchive& Ar ) { bLoaded = SerializerArchives::SerializeObject( Ar, actor, save.Encoding, archetype ); } );
+
+	if ( !bLoaded )
+	{
+		return false;
+	}
 
-	if ( actor->GetClass()->ImplementsInterface( UGameSerializable::StaticClass() ) )
+	if ( bNotify )
 	{
-		IGameSerializable::Execute_PostDataLoaded( actor );
+		NotifyDataLoaded( actor );
 	}
 
-	UE_LOG( LogSaveGame, Log, TEXT( "Loaded data into %s" ), *actor->GetName() );
+	UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Loaded data into %s" ), *actor->GetName() );
 
 	//try
 	//{
@@ -99,9 +270,25 @@ void USerializationHelpers::LoadActor(AActor* actor, FSerializedActor save)
 	//{
 	//	UE_LOG(LogTemp, Error, TEXT("Failed to load %s"), *actor->GetName());
 	//}
+
+	return true;
+}
+
+void USerializationHelpers::NotifyDataLoaded( UObject* object )
+{
+	if ( object && object->GetClass()->ImplementsInterface( UGameSerializable::StaticClass() ) )
+	{
+		SCOPE_CYCLE_COUNTER( STAT_GameSerializer_PostDataLoaded );
+		IGameSerializable::Execute_PostDataLoaded( object );
+	}
 }
 
 void USerializationHelpers::LoadObject( UObject * object, FSerializedGameObject save )
+{
+	LoadObject( object, save, nullptr );
+}
+
+void USerializationHelpers::LoadObject( UObject* object, const FSerializedGameObject& save, FGameSerializerReferenceTable* references )
 {
 	ensure( object );
 
@@ -111,27 +298,50 @@ void USerializationHelpers::LoadObject( UObject * object, FSerializedGameObject
 		return;
 	}
 
+	if ( save.bUsesReferenceTable && !references )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Can't load %s without the reference table it was saved with!" ), *object->GetName() );
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_LoadObject );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "LoadObject %s" ), *object->GetClass()->GetName() );
+
 	FMemoryReader MemoryReader( save.Data );
-	FGameSerializerArchive Ar( MemoryReader );
 
-	object->Serialize( Ar );
+	bool bLoaded = false;
+	SerializerArchives::WithArchive( MemoryReader, save.bUsesReferenceTable ? references : nullptr, [object, &save, &bLoaded]( FArchive& Ar ) { bLoaded = SerializerArchives::SerializeObject( Ar, object, save.Encoding ); } );
 
-	if ( object->GetClass()->ImplementsInterface( UGameSerializable::StaticClass() ) )
+	if ( !bLoaded )
 	{
-		IGameSerializable::Execute_PostDataLoaded( object );
+		return;
 	}
 
-	UE_LOG( LogSaveGame, Warning, TEXT( "Loaded data into %s" ), *object->GetPathName() );
+	NotifyDataLoaded( object );
+
+	UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Loaded data into %s" ), *object->GetPathName() );
 }
 
-AActor* USerializationHelpers::SpawnAndLoadActor(UObject* WorldContextObject, FSerializedActor save)
+FGameSerializerReferenceTable* USerializationHelpers::GetReferenceTable( FGameSerializerReferenceTable& table )
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	if ( settings && settings->ReferenceMode == EGameSerializerReferenceMode::ReferenceTable )
+	{
+		return &table;
+	}
+
+	return nullptr;
+}
+
+AActor* USerializationHelpers::SpawnAndLoadActor(UObject* WorldContextObject, const FSerializedActor& save)
 {
 	AActor* actor = nullptr;
 
 	if (save.ActorClass != nullptr && WorldContextObject != nullptr)
 	{
 		auto world = WorldContextObject->GetWorld();
-		FTransform transform = save.ActorTransform;
+		const FTransform& transform = save.ActorTransform;
 		auto params = FActorSpawnParameters();
 
 		//params.Name = //serialized name
@@ -165,6 +375,81 @@ FName USerializationHelpers::ResolveID( UObject* object )
 	return FName( *object->GetPathName() );
 }
 
+int64 USerializationHelpers::ResolveActorID( AActor* actor )
+{
+	if ( !actor ) { return 0; }
+
+	if ( USerializableIdentityComponent* identity = actor->FindComponentByClass< USerializableIdentityComponent >() )
+	{
+		if ( identity->PersistentId != 0 )
+		{
+			return identity->PersistentId;
+		}
+	}
+
+	// The path is only unique within the level, which is all a world's save data needs, and doesn't change between PIE and standalone
+	TStringBuilder< 256 > path;
+	actor->GetPathName( actor->GetLevel(), path );
+
+	return (int64)CityHash64( reinterpret_cast< const char* >( path.GetData() ), path.Len() * sizeof( TCHAR ) );
+}
+
+void USerializationHelpers::AssignActorID( AActor* actor, int64 id )
+{
+	if ( !actor ) { return; }
+
+	EnsureActorID( actor );
+
+	if ( USerializableIdentityComponent* identity = actor->FindComponentByClass< USerializableIdentityComponent >() )
+	{
+		identity->PersistentId = id;
+	}
+}
+
+void USerializationHelpers::EnsureActorID( AActor* actor )
+{
+	if ( !actor || actor->FindComponentByClass< USerializableIdentityComponent >() )
+	{
+		return;
+	}
+
+	USerializableIdentityComponent* identity = NewObject< USerializableIdentityComponent >( actor );
+	identity->PersistentId = USerializableIdentityComponent::GenerateId();
+	actor->AddInstanceComponent( identity );
+
+	// Actors still spawning register it with the rest of their components, ones on their way out don't need it registered
+	if ( actor->HasActorRegisteredAllComponents() && !actor->IsActorBeingDestroyed() )
+	{
+		identity->RegisterComponent();
+	}
+}
+
+void USerializationHelpers::PreModifyActor( AActor* actor )
+{
+	if ( !actor || !actor->GetWorld() || !actor->GetWorld()->GetGameInstance() )
+	{
+		return;
+	}
+
+	if ( UGameSaveManager* manager = actor->GetWorld()->GetGameInstance()->GetSubsystem< UGameSaveManager >() )
+	{
+		manager->PreModifyActor( actor );
+	}
+}
+
+void USerializationHelpers::MarkActorDirty( AActor* actor )
+{
+	if ( !actor || !actor->GetWorld() || !actor->GetWorld()->GetGameInstance() )
+	{
+		return;
+	}
+
+	if ( UGameSaveManager* manager = actor->GetWorld()->GetGameInstance()->GetSubsystem< UGameSaveManager >() )
+	{
+		manager->MarkActorDirty( actor );
+	}
+}
+
 bool USerializationHelpers::IsClassBlacklisted( TSubclassOf<UObject> objectClass )
 {
 	TArray< TSubclassOf< UObject > > Blacklist = TArray< TSubclassOf< UObject > >();
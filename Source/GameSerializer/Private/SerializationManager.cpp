@@ -5,62 +5,273 @@
 #include "Classes.h"
 #include "SerializationHelpers.h"
 #include "GameSerializerSettings.h"
+#include "GameSerializerStats.h"
+#include "SerializationSchema.h"
+#include "GameSerializerTransformCodec.h"
 
 #include "CoreMinimal.h"
 #include "Engine/World.h"
 #include "EngineUtils.h"
 #include "IGameSerializable.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/GameplayStatics.h"
+#include "TimerManager.h"
 
+namespace SaveCapture
+{
+	/** Entries a reference table may gain through incremental captures before the next capture starts it over, on top of doubling. */
+	static const int32 ReferenceTableSlack = 256;
+
+	static int32 GetReferenceCount( const FGameSerializerReferenceTable& table )
+	{
+		return table.Names.Num() + table.ObjectPaths.Num();
+	}
+}
 
 // Sets default values for this component's properties
 ASerializationManager::ASerializationManager()
 {
-
+	// Only ticks while a budgeted restore is running
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 }
 
 
-void ASerializationManager::LoadWorldState( FSerializedWorld state )
+void ASerializationManager::LoadWorldState( FSerializedWorld&& state )
 {
-	WorldData = state;
+	LLM_SCOPE_BYTAG( GameSerializer_Restore );
+
+	// A new state replaces whatever was still being restored or captured
+	PendingRestores.Reset();
+	RestoreCursor = 0;
+
+	bCapturing = false;
+	CaptureQueue.Reset();
+	CaptureQueueIndex.Reset();
+	ArenaSpans.Reset();
+	PreviousWorldData = FSerializedWorld();
+
+	SharedWorldData.Reset();
+	WorldData = MoveTemp( state );
+	bWorldStateReleased = false;
+	bWorldDirty = false;
+	FullCaptureReferenceCount = SaveCapture::GetReferenceCount( WorldData.References );
 
-	UWorld* world = GetWorld();
 	UObject* outer = GetLevel()->GetOuter();
 
-	TMap< AActor*, FSerializedActor > Spawned = TMap< AActor*, FSerializedActor >();
+	TMap< int64, AActor* > liveActors;
 
-	for ( auto&& keypair : state.Actors )
+	for ( const TWeakObjectPtr< AActor >& weakActor : SerializableActors )
 	{
-		if ( keypair.Value.bWasSpawned )
+		AActor* actor = weakActor.Get();
+
+		if ( actor && actor->GetLevel()->GetOuter() == outer )
 		{
-			Spawned.Add( 
-				GetWorld()->SpawnActorDeferred<AActor>( keypair.Value.ActorClass, keypair.Value.ActorTransform, this ),
-				keypair.Value
-				);
+			liveActors.Add( USerializationHelpers::ResolveActorID( actor ), actor );
 		}
 	}
 
-	for ( TActorIterator< AActor > Iter( GetWorld() ); Iter; ++Iter )
+	FVector origin = FVector::ZeroVector;
+	const APawn* player = UGameplayStatics::GetPlayerPawn( this, 0 );
+
+	if ( player )
 	{
-		AActor* actor = *Iter;
+		origin = player->GetActorLocation();
+	}
 
-		if ( actor->GetLevel()->GetOuter() == outer )
+	for ( auto&& keypair : WorldData.Actors )
+	{
+		FPendingRestore pending;
+		pending.Id = keypair.Key;
+
+		// Spawned actors that are still around (the level never went away) get reused rather than duplicated
+		if ( AActor** live = liveActors.Find( keypair.Key ) )
 		{
-			FName actorID = USerializationHelpers::ResolveID( actor );
-			if ( state.Actors.Contains( actorID ) )
-			{
-				USerializationHelpers::LoadActor( actor, state.Actors[actorID] );
+			pending.Actor = *live;
+		}
+		else if ( keypair.Value.bWasSpawned )
+		{
+			pending.bSpawn = true;
+		}
+		else
+		{
+			continue;
+		}
 
-				if ( actor->ActorHasTag( SaveTags::IgnoreTransform ) == false )
-				{
-					actor->SetActorTransform( state.Actors[actorID].ActorTransform, false, nullptr, ETeleportType::ResetPhysics );
-				}
-			}
+		pending.Priority = FVector::DistSquared( keypair.Value.ActorTransform.GetLocation(), origin );
+		PendingRestores.Add( pending );
+	}
+
+	if ( player )
+	{
+		PendingRestores.Sort( []( const FPendingRestore& a, const FPendingRestore& b ) { return a.Priority < b.Priority; } );
+	}
+
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	const double budget = settings ? settings->RestoreBudgetMs / 1000.0 : 0.0;
+
+	ProcessRestores( budget );
+
+	if ( IsRestoring() )
+	{
+		SetActorTickEnabled( true );
+	}
+}
+
+void ASerializationManager::ReleaseWorldState()
+{
+	PendingRestores.Reset();
+	RestoreCursor = 0;
+	SetActorTickEnabled( false );
+
+	bCapturing = false;
+	CaptureQueue.Reset();
+	CaptureQueueIndex.Reset();
+	ArenaSpans.Reset();
+	PreviousWorldData = FSerializedWorld();
+
+	SharedWorldData.Reset();
+	WorldData = FSerializedWorld();
+	bWorldStateReleased = true;
+}
+
+void ASerializationManager::Tick( float DeltaSeconds )
+{
+	Super::Tick( DeltaSeconds );
+
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	ProcessRestores( settings ? settings->RestoreBudgetMs / 1000.0 : 0.0 );
+}
+
+void ASerializationManager::ProcessRestores( double budgetSeconds )
+{
+	LLM_SCOPE_BYTAG( GameSerializer_Restore );
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_RestoreWorld );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "RestoreWorld %s" ), *WorldID.ToString() );
+
+	const double deadline = FPlatformTime::Seconds() + budgetSeconds;
+
+	// Always make progress, even if a single actor blows the budget
+	while ( RestoreCursor < PendingRestores.Num() )
+	{
+		RestoreActor( PendingRestores[RestoreCursor++] );
+
+		if ( budgetSeconds > 0.0 && FPlatformTime::Seconds() >= deadline )
+		{
+			break;
 		}
 	}
 
-	for ( auto&& actorData : Spawned )
+	if ( RestoreCursor >= PendingRestores.Num() )
 	{
-		actorData.Key->FinishSpawning( actorData.Value.ActorTransform );
+		FinishRestore();
+	}
+}
+
+void ASerializationManager::RestoreActor( const FPendingRestore& pending )
+{
+	const FSerializedActor* record = WorldData.Actors.Find( pending.Id );
+
+	if ( !record )
+	{
+		return;
+	}
+
+	if ( pending.bSpawn )
+	{
+		SCOPE_CYCLE_COUNTER( STAT_GameSerializer_SpawnActor );
+		GAMESERIALIZER_TRACE_SCOPE( TEXT( "SpawnActor %s" ), *GetNameSafe( record->ActorClass ) );
+
+		AActor* actor = GetWorld()->SpawnActorDeferred<AActor>( record->ActorClass, record->ActorTransform, this );
+
+		if ( !actor )
+		{
+			return;
+		}
+
+		RegisterActor( actor );
+
+		// The construction script would overwrite whatever was loaded before it, and PostDataLoaded should find the actor playing
+		actor->FinishSpawning( record->ActorTransform );
+
+		USerializationHelpers::AssignActorID( actor, pending.Id );
+		USerializationHelpers::LoadActor( actor, *record, WorldData );
+		return;
+	}
+
+	AActor* actor = pending.Actor.Get();
+
+	if ( !actor )
+	{
+		return;
+	}
+
+	if ( USerializationHelpers::LoadActor( actor, *record, WorldData, GetArchetype( actor ), false ) )
+	{
+		NotifyDataLoaded( actor );
+	}
+
+	// Actors that are already where they were saved, give or take their codec's precision, don't need to be moved
+	if ( actor->ActorHasTag( SaveTags::IgnoreTransform ) == false && !FGameSerializerTransformCodec::Matches( actor->GetActorTransform(), record->ActorTransform, record->TransformCodec, WorldData.TransformStep ) )
+	{
+		actor->SetActorTransform( record->ActorTransform, false, nullptr, ETeleportType::ResetPhysics );
+	}
+}
+
+void ASerializationManager::NotifyDataLoaded( AActor* actor )
+{
+	if ( actor->HasActorBegunPlay() )
+	{
+		USerializationHelpers::NotifyDataLoaded( actor );
+		return;
+	}
+
+	// Placed actors can come after us in the level's BeginPlay pass, by next tick all of them had theirs
+	PendingDataLoaded.Add( actor );
+
+	if ( !DataLoadedTimer.IsValid() )
+	{
+		DataLoadedTimer = GetWorldTimerManager().SetTimerForNextTick( this, &ASerializationManager::FlushDataLoaded );
+	}
+}
+
+void ASerializationManager::FlushDataLoaded()
+{
+	DataLoadedTimer.Invalidate();
+
+	TArray< TWeakObjectPtr< AActor > > pending = MoveTemp( PendingDataLoaded );
+
+	for ( const TWeakObjectPtr< AActor >& weakActor : pending )
+	{
+		if ( AActor* actor = weakActor.Get() )
+		{
+			USerializationHelpers::NotifyDataLoaded( actor );
+		}
+	}
+}
+
+void ASerializationManager::FinishRestore()
+{
+	PendingRestores.Reset();
+	RestoreCursor = 0;
+	SetActorTickEnabled( false );
+
+	OnWorldRestored.Broadcast( WorldID );
+
+	if ( SaveManagerRef )
+	{
+		SaveManagerRef->OnWorldRestored.Broadcast( WorldID );
+	}
+}
+
+void ASerializationManager::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// The level's actors are initialized before any of them begins play, game code hasn't changed their SaveGame properties yet
+	if ( GetWorld() && GetWorld()->IsGameWorld() )
+	{
+		TakeArchetypes();
 	}
 }
 
@@ -70,32 +281,57 @@ void ASerializationManager::BeginPlay()
 	Super::BeginPlay();
 
 	WorldRef = Cast< UWorld >( GetLevel()->GetOuter() );
-	UE_LOG( LogSaveGame, Warning, TEXT( "%s" ), *GetWorld()->GetName() );
-	UE_LOG( LogSaveGame, Warning, TEXT( "Initialized Serialization Manager %s" ), *this->GetName() );
+	UE_LOG( LogSaveGame, Verbose, TEXT( "Initialized Serialization Manager %s in %s" ), *GetName(), *GetWorld()->GetName() );
 	// 
 
 	UGameSaveManager* manager = USerializationHelpers::GetGameSaveManager( this );
 	SaveManagerRef = manager;
 
-	LoadWorldState( manager->GetWorldState( WorldID ) );
+	BuildActorRegistry();
+	manager->RegisterSerializationManager( this );
+
+	LoadWorldState( manager->TakeWorldState( WorldID ) );
 }
 
 void ASerializationManager::BeginDestroy()
 {
-	UE_LOG( LogSaveGame, Warning, TEXT( "Manager Begin Destroy!" ) );
+	UE_LOG( LogSaveGame, Verbose, TEXT( "Manager Begin Destroy!" ) );
 	Super::BeginDestroy();
 
 }
 
 void ASerializationManager::EndPlay( const EEndPlayReason::Type EndPlayReason )
 {
-	UE_LOG( LogSaveGame, Warning, TEXT( "Manager End Play!" ) );
-	
-	if ( EndPlayReason != EEndPlayReason::Quit )
+	UE_LOG( LogSaveGame, Verbose, TEXT( "Manager End Play!" ) );
+
+	bEndingPlay = true;
+
+	if ( EndPlayReason != EEndPlayReason::Quit && !bWorldStateReleased )
 	{
 		CacheWorld();
+
+		if ( SaveManagerRef )
+		{
+			SaveManagerRef->CacheWorldState( WorldID, MoveTemp( WorldData ), bWorldDirty );
+		}
+		else
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Failed to cache world state!" ) );
+		}
 	}
 
+	if ( SaveManagerRef )
+	{
+		SaveManagerRef->UnregisterSerializationManager( this );
+	}
+
+	SerializableActors.Empty();
+	Archetypes.Empty();
+
+	// Whoever didn't begin play by now is leaving with the level
+	GetWorldTimerManager().ClearTimer( DataLoadedTimer );
+	PendingDataLoaded.Empty();
+
 	Super::EndPlay( EndPlayReason );
 }
 
@@ -103,79 +339,451 @@ void ASerializationManager::PreDelete( AActor* actor, EEndPlayReason::Type EndPl
 {
 }
 
+void ASerializationManager::RegisterActor( AActor* actor )
+{
+	if ( !IsSerializableActor( actor ) || actor->GetLevel() != GetLevel() )
+	{
+		return;
+	}
+
+	SerializableActors.Add( actor );
+}
+
+void ASerializationManager::UnregisterActor( AActor* actor )
+{
+	SerializableActors.Remove( actor );
+	Archetypes.Remove( actor );
+}
+
+const FGameSerializerSnapshot* ASerializationManager::GetArchetype( const AActor* actor ) const
+{
+	const TSharedPtr< FGameSerializerSnapshot >* snapshot = Archetypes.Find( actor );
+	return snapshot ? snapshot->Get() : nullptr;
+}
+
+bool ASerializationManager::IsSerializableActor( const AActor* actor )
+{
+	return actor && actor->Implements< UGameSerializable >();
+}
+
+SIZE_T ASerializationManager::GetWorldAllocatedSize( TSet< const void* >* countedBuffers ) const
+{
+	SIZE_T size = WorldData.GetAllocatedSize() + PreviousWorldData.GetAllocatedSize() + SpareArena.GetAllocatedSize();
+
+	if ( SharedWorldData.IsValid() && FSerializedGameState::ShouldCountShared( SharedWorldData.Get(), countedBuffers ) )
+	{
+		size += SharedWorldData->GetAllocatedSize();
+	}
+
+	size += SerializableActors.GetAllocatedSize() + CaptureQueue.GetAllocatedSize() + CaptureQueueIndex.GetAllocatedSize() + PendingRestores.GetAllocatedSize();
+	size += Archetypes.GetAllocatedSize();
+
+	for ( const TPair< TObjectKey< AActor >, TSharedPtr< FGameSerializerSnapshot > >& archetype : Archetypes )
+	{
+		size += archetype.Value->GetAllocatedSize();
+	}
+
+	return size;
+}
+
+void ASerializationManager::GetResourceSizeEx( FResourceSizeEx& CumulativeResourceSize )
+{
+	Super::GetResourceSizeEx( CumulativeResourceSize );
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes( GetWorldAllocatedSize() );
+}
+
+FSharedWorldPtr ASerializationManager::ShareWorldState()
+{
+	if ( !SharedWorldData.IsValid() )
+	{
+		SharedWorldData = MakeShared< FSerializedWorld, ESPMode::ThreadSafe >( MoveTemp( WorldData ) );
+		WorldData = FSerializedWorld();
+	}
+
+	return SharedWorldData;
+}
+
+void ASerializationManager::ReclaimWorldState()
+{
+	if ( !SharedWorldData.IsValid() )
+	{
+		return;
+	}
+
+	// Nobody else holds it anymore and nobody can pick it up meanwhile, so it can be taken back whole
+	if ( SharedWorldData.IsUnique() )
+	{
+		WorldData = MoveTemp( *SharedWorldData );
+	}
+	else
+	{
+		WorldData = *SharedWorldData;
+	}
+
+	SharedWorldData.Reset();
+}
+
+void ASerializationManager::BuildActorRegistry()
+{
+	SerializableActors.Reset();
+
+	for ( AActor* actor : GetLevel()->Actors )
+	{
+		RegisterActor( actor );
+	}
+}
+
+void ASerializationManager::TakeArchetypes()
+{
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+
+	if ( !settings || !settings->bUseCompiledSchemas )
+	{
+		return;
+	}
+
+	for ( AActor* actor : GetLevel()->Actors )
+	{
+		if ( actor && actor->bNetStartup && IsSerializableActor( actor ) && !Archetypes.Contains( actor ) )
+		{
+			if ( TSharedPtr< FGameSerializerSnapshot > snapshot = FGameSerializerSnapshot::Take( actor ) )
+			{
+				Archetypes.Add( actor, snapshot );
+			}
+		}
+	}
+}
+
 void ASerializationManager::CacheWorld()
 {
 	////Get master scene
 	////record all actors
 
-	UWorld* world = GetWorld();
-	UObject* outer = GetLevel()->GetOuter();
+	// An amortized capture that's still running just gets finished now
+	if ( !bCapturing )
+	{
+		BeginCapture();
+	}
 
-	WorldData = FSerializedWorld();
+	StepCapture( 0.0 );
+	FinishCapture();
+}
+
+void ASerializationManager::BeginCapture()
+{
+	LLM_SCOPE_BYTAG( GameSerializer_Capture );
 
-	for ( TActorIterator< AActor > Iter( GetWorld() ); Iter; ++Iter )
+	// Actors that haven't been restored yet would be captured in their default state.
+	// Leaving play nothing gets spawned or loaded anymore, their saved records go into the capture as they are.
+	TArray< int64 > unrestored;
+
+	if ( IsRestoring() )
 	{
-		AActor* actor = *Iter;
+		if ( bEndingPlay )
+		{
+			for ( int32 index = RestoreCursor; index < PendingRestores.Num(); index++ )
+			{
+				unrestored.Add( PendingRestores[index].Id );
+			}
 
-		//Serialization on scene actors is opt in now
-		if(!actor->Implements<UGameSerializable>())
+			PendingRestores.Reset();
+			RestoreCursor = 0;
+			SetActorTickEnabled( false );
+		}
+		else
 		{
-			continue;
+			ProcessRestores( 0.0 );
 		}
+	}
+
+	if ( !SaveManagerRef )
+	{
+		UGameInstance* gameInstance = GetWorld()->GetGameInstance();
+		SaveManagerRef = gameInstance ? gameInstance->GetSubsystem<UGameSaveManager>() : nullptr;
+	}
 
-		TSubclassOf<AActor> aClass = actor->GetClass();
+	// Keep the last capture around so unchanged actors can hand their blob over
+	ReclaimWorldState();
+	PreviousWorldData = MoveTemp( WorldData );
+	WorldData = FSerializedWorld();
 
-		if ( USerializationHelpers::IsClassBlacklisted( aClass ) )
-		{
-			UE_LOG( LogSaveGame, Warning, TEXT( "Ignored %s" ), *actor->GetPathName() );
-			continue;
-		}
+	// Entries of actors that are gone pile up in a table incremental captures keep, once it doubled the capture is a full one
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	const bool bTableGrown = SaveCapture::GetReferenceCount( PreviousWorldData.References ) > FullCaptureReferenceCount * 2 + SaveCapture::ReferenceTableSlack;
+	bIncrementalCapture = SaveManagerRef && settings && settings->bIncrementalCapture && !bTableGrown;
+	LastCaptureStats = FGameSerializerCaptureStats();
 
-		if ( actor->ActorHasTag( SaveTags::Ignore ) || actor->IsRootComponentStatic() )
+	// Blobs go into the arena the capture before last used, it's usually already big enough
+	WorldData.ActorArena = MoveTemp( SpareArena );
+	WorldData.ActorArena.Reset();
+	WorldData.ActorArena.Reserve( PreviousWorldData.ActorArena.Num() );
+
+	// Reused and carried blobs keep indexing into the old reference table, so it only starts over on full captures
+	bKeepReferences = bIncrementalCapture || unrestored.Num() > 0;
+
+	if ( bKeepReferences )
+	{
+		WorldData.References = MoveTemp( PreviousWorldData.References );
+	}
+
+	// This is the capture epoch, actors spawned from here on belong to the next capture
+	CaptureQueue.Reset( SerializableActors.Num() );
+	CaptureQueueIndex.Reset();
+	ArenaSpans.Reset();
+	TransformCodecs.Reset();
+
+	for ( const TWeakObjectPtr< AActor >& weakActor : SerializableActors )
+	{
+		if ( AActor* actor = weakActor.Get() )
 		{
-			UE_LOG( LogSaveGame, Warning, TEXT( "Ignored %s" ), *actor->GetPathName() );
-			continue;
+			CaptureQueueIndex.Add( actor, CaptureQueue.Add( weakActor ) );
 		}
+	}
 
-		if ( AActor* parent = actor->GetParentActor() )
+	for ( const int64 id : unrestored )
+	{
+		if ( FSerializedActor* record = PreviousWorldData.Actors.Find( id ) )
 		{
-			if ( actor->IsChildActor() && parent->ActorHasTag( SaveTags::Ignore ) )
+			const TArrayView< const uint8 > blob = PreviousWorldData.GetActorData( *record );
+			FSerializedActor& carried = WorldData.Actors.Add( id, MoveTemp( *record ) );
+			WorldData.TransformStep = FMath::Max( WorldData.TransformStep, PreviousWorldData.TransformStep );
+
+			if ( carried.ArenaOffset != INDEX_NONE )
 			{
-				UE_LOG( LogSaveGame, Warning, TEXT( "Ignored %s" ), *actor->GetPathName() );
-				continue;
+				carried.ArenaOffset = WorldData.ActorArena.Num();
+				WorldData.ActorArena.Append( blob.GetData(), blob.Num() );
 			}
+
+			LastCaptureStats.ActorsReused++;
+			LastCaptureStats.AddActor( carried.ActorClass, blob.Num() );
+			ShareArenaSpan( carried );
+
+			CarriedActors.Add( id );
 		}
+	}
+
+	CaptureCursor = 0;
+	bCapturing = true;
+}
+
+bool ASerializationManager::StepCapture( double budgetSeconds )
+{
+	if ( !bCapturing )
+	{
+		return true;
+	}
 
-		if ( !actor->ActorHasTag( SaveTags::Save ) )
+	SCOPE_CYCLE_COUNTER( STAT_GameSerializer_CaptureWorld );
+	LLM_SCOPE_BYTAG( GameSerializer_Capture );
+	GAMESERIALIZER_TRACE_SCOPE( TEXT( "CaptureWorld %s" ), *WorldID.ToString() );
+
+	const double deadline = FPlatformTime::Seconds() + budgetSeconds;
+
+	while ( CaptureCursor < CaptureQueue.Num() )
+	{
+		TWeakObjectPtr< AActor > weakActor = CaptureQueue[CaptureCursor];
+		CaptureQueue[CaptureCursor++].Reset();
+
+		if ( AActor* actor = weakActor.Get() )
 		{
-			UE_LOG( LogSaveGame, Warning, TEXT( "Ignored %s" ), *actor->GetPathName() );
-			continue;
+			CaptureActor( actor );
 		}
 
-		if ( actor->GetLevel()->GetOuter() == outer )
+		if ( budgetSeconds > 0.0 && FPlatformTime::Seconds() >= deadline )
 		{
-			FSerializedActor save = USerializationHelpers::SaveActor( actor );
-
-			WorldData.Actors.Add( USerializationHelpers::ResolveID( actor ), save );
-
-			UE_LOG( LogSaveGame, Warning, TEXT( "Found actor %s :: Full path == %s" ), *actor->GetName(), *actor->GetPathName() );
+			break;
 		}
 	}
 
-	UGameInstance* gameInstance = GetWorld()->GetGameInstance();
-	UGameSaveManager* manager = gameInstance->GetSubsystem<UGameSaveManager>();
+	return CaptureCursor >= CaptureQueue.Num();
+}
+
+void ASerializationManager::FinishCapture()
+{
+	if ( !bCapturing )
+	{
+		return;
+	}
 
 	//Cache the existence of the level
 	WorldData.bLoaded = GetLevel()->bIsVisible;
 
-	if ( manager )
+	// Actors that came or went, or a reference table that came out different, change the world even if every blob matched
+	bWorldDirty = bWorldDirty
+		|| WorldData.Actors.Num() != PreviousWorldData.Actors.Num()
+		|| WorldData.bLoaded != PreviousWorldData.bLoaded
+		|| ( !bKeepReferences && !WorldData.References.Matches( PreviousWorldData.References ) );
+
+	if ( !bKeepReferences )
 	{
-		manager->CacheWorldState( WorldID, WorldData );
-		//manager->CacheWorldState( FName( *WorldRef.GetUniqueID().ToString() ), WorldData );
-		//UE_LOG( LogTemp, Warning, TEXT( "Serialized %s actors!" ), *FString::FromInt( WorldData.Actors.Num() ) );
+		FullCaptureReferenceCount = SaveCapture::GetReferenceCount( WorldData.References );
 	}
-	else
+
+	bCapturing = false;
+	CaptureQueue.Reset();
+	CaptureQueueIndex.Reset();
+	ArenaSpans.Reset();
+	CarriedActors.Reset();
+
+	SpareArena = MoveTemp( PreviousWorldData.ActorArena );
+	PreviousWorldData = FSerializedWorld();
+}
+
+void ASerializationManager::CaptureActorNow( AActor* actor )
+{
+	if ( !bCapturing || !actor )
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG( GameSerializer_Capture );
+
+	const int32* index = CaptureQueueIndex.Find( actor );
+
+	// Not part of this capture, or already captured
+	if ( !index || !CaptureQueue[*index].IsValid() )
+	{
+		return;
+	}
+
+	CaptureQueue[*index].Reset();
+	CaptureActor( actor );
+}
+
+void ASerializationManager::CaptureActor( AActor* actor )
+{
+	UObject* outer = GetLevel()->GetOuter();
+
+	TSubclassOf<AActor> aClass = actor->GetClass();
+
+	// Skipped actors are only counted, the reasons end up in the capture summary
+	if ( USerializationHelpers::IsClassBlacklisted( aClass ) )
+	{
+		LastCaptureStats.IgnoredBlacklisted++;
+		UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Ignored %s, its class is blacklisted" ), *actor->GetPathName() );
+		return;
+	}
+
+	if ( actor->ActorHasTag( SaveTags::Ignore ) )
+	{
+		LastCaptureStats.IgnoredTagged++;
+		UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Ignored %s, it's tagged Ignore" ), *actor->GetPathName() );
+		return;
+	}
+
+	if ( actor->IsRootComponentStatic() )
+	{
+		LastCaptureStats.IgnoredStatic++;
+		UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Ignored %s, its root is static" ), *actor->GetPathName() );
+		return;
+	}
+
+	if ( AActor* parent = actor->GetParentActor() )
+	{
+		if ( actor->IsChildActor() && parent->ActorHasTag( SaveTags::Ignore ) )
+		{
+			LastCaptureStats.IgnoredTagged++;
+			UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Ignored %s, its parent is tagged Ignore" ), *actor->GetPathName() );
+			return;
+		}
+	}
+
+	if ( !actor->ActorHasTag( SaveTags::Save ) )
+	{
+		LastCaptureStats.IgnoredUntagged++;
+		UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Ignored %s, it isn't tagged Save" ), *actor->GetPathName() );
+		return;
+	}
+
+	if ( actor->GetLevel()->GetOuter() != outer )
+	{
+		return;
+	}
+
+	if ( !actor->bNetStartup )
+	{
+		USerializationHelpers::EnsureActorID( actor );
+	}
+
+	const int64 actorID = USerializationHelpers::ResolveActorID( actor );
+
+	// Never restored, its saved record was already carried over
+	if ( CarriedActors.Contains( actorID ) )
+	{
+		return;
+	}
+
+	const bool bDirty = SaveManagerRef && SaveManagerRef->ConsumeActorDirty( actor );
+	FSerializedActor* last = bIncrementalCapture && !bDirty ? PreviousWorldData.Actors.Find( actorID ) : nullptr;
+
+	if ( last && last->ActorClass == actor->GetClass() && FGameSerializerTransformCodec::Matches( last->ActorTransform, actor->GetTransform(), last->TransformCodec, PreviousWorldData.TransformStep ) )
 	{
-		UE_LOG( LogSaveGame, Error, TEXT( "Failed to cache world state!" ) );
+		const TArrayView< const uint8 > blob = PreviousWorldData.GetActorData( *last );
+		FSerializedActor& reused = WorldData.Actors.Add( actorID, MoveTemp( *last ) );
+
+		// The reused record is still rounded to the step it was decoded with
+		WorldData.TransformStep = FMath::Max( WorldData.TransformStep, PreviousWorldData.TransformStep );
+
+		if ( reused.ArenaOffset != INDEX_NONE )
+		{
+			reused.ArenaOffset = WorldData.ActorArena.Num();
+			WorldData.ActorArena.Append( blob.GetData(), blob.Num() );
+		}
+
+		LastCaptureStats.ActorsReused++;
+		LastCaptureStats.AddActor( reused.ActorClass, blob.Num() );
+		ShareArenaSpan( reused );
+		return;
 	}
+
+	FSerializedActor& save = WorldData.Actors.Add( actorID, USerializationHelpers::SaveActor( actor, USerializationHelpers::GetReferenceTable( WorldData.References ), WorldData.ActorArena, GetArchetype( actor ) ) );
+	save.TransformCodec = FGameSerializerTransformCodec::Resolve( actor, TransformCodecs );
+
+	if ( !bWorldDirty )
+	{
+		const FSerializedActor* previous = PreviousWorldData.Actors.Find( actorID );
+		bWorldDirty = !previous || previous->Fingerprint != save.Fingerprint || previous->ActorClass != save.ActorClass
+			|| !FGameSerializerTransformCodec::Matches( previous->ActorTransform, save.ActorTransform, save.TransformCodec, PreviousWorldData.TransformStep );
+
+		// Equal fingerprints only say the blobs are probably the same, a collision would lose the change
+		if ( !bWorldDirty )
+		{
+			const TArrayView< const uint8 > previousBlob = PreviousWorldData.GetActorData( *previous );
+			const TArrayView< const uint8 > blob = WorldData.GetActorData( save );
+			bWorldDirty = previousBlob.Num() != blob.Num() || FMemory::Memcmp( previousBlob.GetData(), blob.GetData(), blob.Num() ) != 0;
+		}
+	}
+
+	LastCaptureStats.ActorsSerialized++;
+	LastCaptureStats.AddActor( save.ActorClass, WorldData.GetActorData( save ).Num() );
+	ShareArenaSpan( save );
+
+	UE_LOG( LogSaveGameDetail, Verbose, TEXT( "Captured %s" ), *actor->GetPathName() );
+}
+
+bool ASerializationManager::ShareArenaSpan( FSerializedActor& actor )
+{
+	if ( actor.ArenaOffset == INDEX_NONE )
+	{
+		return false;
+	}
+
+	check( actor.ArenaOffset + actor.ArenaSize == WorldData.ActorArena.Num() );
+
+	const uint64 key = (uint64)(uint32)actor.Fingerprint | ( (uint64)actor.ArenaSize << 32 );
+	const int32 offset = ArenaSpans.FindOrAdd( key, actor.ArenaOffset );
+	const uint8* arena = WorldData.ActorArena.GetData();
+
+	// A fingerprint collision keeps its own copy, the first blob with that key stays the one others get matched against
+	if ( offset == actor.ArenaOffset || FMemory::Memcmp( arena + offset, arena + actor.ArenaOffset, actor.ArenaSize ) != 0 )
+	{
+		LastCaptureStats.ArenaBytes += actor.ArenaSize;
+		return false;
+	}
+
+	WorldData.ActorArena.SetNum( actor.ArenaOffset, false );
+	actor.ArenaOffset = offset;
+
+	LastCaptureStats.ActorsShared++;
+	return true;
 }
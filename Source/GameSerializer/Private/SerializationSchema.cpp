@@ -0,0 +1,388 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SerializationSchema.h"
+
+#include "GameSerializer.h"
+
+#include "Misc/ScopeLock.h"
+#include "Serialization/StructuredArchive.h"
+#include "UObject/EnumProperty.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/UnrealType.h"
+
+TMap< FObjectKey, TSharedRef< const FGameSerializerClassSchema > > FGameSerializerClassSchema::Cache;
+FCriticalSection FGameSerializerClassSchema::CacheLock;
+FDelegateHandle FGameSerializerClassSchema::ReloadHandle;
+FDelegateHandle FGameSerializerClassSchema::ReplacedHandle;
+
+namespace SaveSchema
+{
+	/** What a delta blob was taken against, written in front of its properties. */
+	enum class EDeltaBase : uint8
+	{
+		ClassDefaults,
+		Snapshot,
+	};
+
+	/** Compares every element of a property's values, both given as value pointers. */
+	static bool IsIdentical( const FProperty* property, const void* a, const void* b )
+	{
+		const int32 elementSize = property->GetSize() / property->ArrayDim;
+
+		for ( int32 index = 0; index < property->ArrayDim; index++ )
+		{
+			if ( !property->Identical( (const uint8*)a + index * elementSize, (const uint8*)b + index * elementSize, PPF_None ) )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static void SerializeProperty( FStructuredArchive::FStream& stream, const FProperty* property, UObject* object )
+	{
+		for ( int32 index = 0; index < property->ArrayDim; index++ )
+		{
+			property->SerializeItem( stream.EnterElement(), property->ContainerPtrToValuePtr< void >( object, index ), nullptr );
+		}
+	}
+}
+
+TSharedRef< const FGameSerializerClassSchema > FGameSerializerClassSchema::Get( const UClass* objectClass )
+{
+	check( objectClass );
+
+	FScopeLock lock( &CacheLock );
+
+	if ( const TSharedRef< const FGameSerializerClassSchema >* cached = Cache.Find( FObjectKey( objectClass ) ) )
+	{
+		if ( ( *cached )->IsUpToDate( objectClass ) )
+		{
+			return *cached;
+		}
+	}
+
+	TSharedRef< const FGameSerializerClassSchema > schema = MakeShareable( new FGameSerializerClassSchema( objectClass ) );
+	Cache.Add( FObjectKey( objectClass ), schema );
+
+	UE_LOG( LogSaveGame, Verbose, TEXT( "Built save schema for %s: %i properties in %i steps" ), *objectClass->GetName(), schema->PropertyCount, schema->Entries.Num() );
+
+	return schema;
+}
+
+void FGameSerializerClassSchema::InvalidateAll()
+{
+	FScopeLock lock( &CacheLock );
+	Cache.Reset();
+}
+
+void FGameSerializerClassSchema::RegisterInvalidationHooks()
+{
+	ReloadHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda( []( EReloadCompleteReason ) { InvalidateAll(); } );
+	ReplacedHandle = FCoreUObjectDelegates::OnObjectsReplaced.AddLambda( []( const TMap< UObject*, UObject* >& ) { InvalidateAll(); } );
+}
+
+void FGameSerializerClassSchema::UnregisterInvalidationHooks()
+{
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove( ReloadHandle );
+	FCoreUObjectDelegates::OnObjectsReplaced.Remove( ReplacedHandle );
+	InvalidateAll();
+}
+
+FGameSerializerClassSchema::FGameSerializerClassSchema( const UClass* objectClass )
+{
+	FirstProperty = objectClass->PropertyLink;
+	PropertiesSize = objectClass->GetPropertiesSize();
+
+	for ( TFieldIterator< FProperty > It( objectClass ); It; ++It )
+	{
+		FProperty* property = *It;
+
+		if ( !property->HasAnyPropertyFlags( CPF_SaveGame ) )
+		{
+			continue;
+		}
+
+		PropertyCount++;
+
+		Hash = FCrc::StrCrc32( *property->GetName(), Hash );
+		Hash = FCrc::StrCrc32( *property->GetClass()->GetName(), Hash );
+		Hash = HashCombine( Hash, GetTypeHash( property->GetOffset_ForInternal() ) );
+		Hash = HashCombine( Hash, GetTypeHash( property->GetSize() ) );
+
+		FGameSerializerSchemaProperty& delta = Properties.AddDefaulted_GetRef();
+		delta.Property = property;
+
+		TArray< const FStructProperty* > encountered;
+
+		if ( !property->ContainsObjectReference( encountered ) )
+		{
+			const int32 alignment = property->GetMinAlignment();
+
+			delta.SnapshotOffset = Align( SnapshotSize, alignment );
+			SnapshotSize = delta.SnapshotOffset + property->GetSize();
+			SnapshotAlignment = FMath::Max( SnapshotAlignment, alignment );
+		}
+
+		const int32 offset = property->GetOffset_ForInternal();
+
+		if ( IsPlainData( property ) )
+		{
+			// Grow the previous run if this property starts right where it ends
+			FGameSerializerSchemaEntry* run = Entries.Num() > 0 && Entries.Last().Property == nullptr ? &Entries.Last() : nullptr;
+
+			if ( run && run->Offset + run->Size == offset )
+			{
+				run->Size += property->GetSize();
+			}
+			else
+			{
+				FGameSerializerSchemaEntry& entry = Entries.AddDefaulted_GetRef();
+				entry.Offset = offset;
+				entry.Size = property->GetSize();
+			}
+
+			continue;
+		}
+
+		FGameSerializerSchemaEntry& entry = Entries.AddDefaulted_GetRef();
+		entry.Property = property;
+		entry.Offset = offset;
+	}
+}
+
+bool FGameSerializerClassSchema::IsUpToDate( const UClass* objectClass ) const
+{
+	return FirstProperty == objectClass->PropertyLink && PropertiesSize == objectClass->GetPropertiesSize();
+}
+
+bool FGameSerializerClassSchema::IsPlainData( const FProperty* property )
+{
+	if ( property->IsA< FNumericProperty >() || property->IsA< FEnumProperty >() )
+	{
+		return true;
+	}
+
+	const FStructProperty* structProperty = CastField< FStructProperty >( property );
+
+	if ( !structProperty || !( structProperty->Struct->StructFlags & STRUCT_IsPlainOldData ) )
+	{
+		return false;
+	}
+
+	// Tagged serialization skips members that aren't SaveGame unless the struct serializes itself
+	const bool bNativeSerializer = ( structProperty->Struct->StructFlags & STRUCT_SerializeNative ) != 0;
+
+	for ( TFieldIterator< FProperty > It( structProperty->Struct ); It; ++It )
+	{
+		if ( !IsPlainData( *It ) || ( !bNativeSerializer && !It->HasAnyPropertyFlags( CPF_SaveGame ) ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FGameSerializerClassSchema::Serialize( FArchive& Ar, UObject* object ) const
+{
+	check( object );
+
+	uint8* base = reinterpret_cast< uint8* >( object );
+
+	FStructuredArchiveFromArchive adapter( Ar );
+	FStructuredArchive::FStream stream = adapter.GetSlot().EnterStream();
+
+	for ( const FGameSerializerSchemaEntry& entry : Entries )
+	{
+		if ( entry.Property == nullptr )
+		{
+			stream.EnterElement().Serialize( base + entry.Offset, entry.Size );
+			continue;
+		}
+
+		SaveSchema::SerializeProperty( stream, entry.Property, object );
+	}
+}
+
+bool FGameSerializerClassSchema::SerializeDelta( FArchive& Ar, UObject* object, const FGameSerializerSnapshot* snapshot ) const
+{
+	check( object );
+	checkf( Properties.Num() <= MAX_uint16, TEXT( "%s has too many SaveGame properties for delta blobs" ), *object->GetClass()->GetName() );
+
+	const bool bSnapshotValid = snapshot && snapshot->IsValidFor( *this );
+	const UObject* defaults = object->GetClass()->GetDefaultObject();
+
+	FStructuredArchiveFromArchive adapter( Ar );
+	FStructuredArchive::FStream stream = adapter.GetSlot().EnterStream();
+
+	if ( Ar.IsSaving() )
+	{
+		if ( snapshot && !bSnapshotValid )
+		{
+			UE_LOG( LogSaveGame, Warning, TEXT( "The archetype snapshot of %s is out of date, using its class defaults" ), *object->GetName() );
+			snapshot = nullptr;
+		}
+
+		uint8 base = (uint8)( snapshot ? SaveSchema::EDeltaBase::Snapshot : SaveSchema::EDeltaBase::ClassDefaults );
+		stream.EnterElement() << base;
+
+		TArray< uint16, TInlineAllocator< 32 > > changed;
+
+		for ( int32 index = 0; index < Properties.Num(); index++ )
+		{
+			const FProperty* property = Properties[index].Property;
+			const void* archetype = GetArchetypeValue( index, defaults, snapshot );
+
+			if ( !archetype || !SaveSchema::IsIdentical( property, property->ContainerPtrToValuePtr< void >( object ), archetype ) )
+			{
+				changed.Add( (uint16)index );
+			}
+		}
+
+		uint16 count = (uint16)changed.Num();
+		stream.EnterElement() << count;
+
+		for ( uint16 index : changed )
+		{
+			stream.EnterElement() << index;
+			SaveSchema::SerializeProperty( stream, Properties[index].Property, object );
+		}
+
+		return true;
+	}
+
+	uint8 base = 0;
+	stream.EnterElement() << base;
+
+	bool bResetMissing = true;
+
+	if ( base == (uint8)SaveSchema::EDeltaBase::ClassDefaults )
+	{
+		snapshot = nullptr;
+	}
+	else if ( base != (uint8)SaveSchema::EDeltaBase::Snapshot || Ar.IsError() )
+	{
+		UE_LOG( LogSaveGame, Error, TEXT( "Delta save data for %s is corrupt, unknown archetype %i" ), *object->GetName(), base );
+		return false;
+	}
+	else if ( !bSnapshotValid )
+	{
+		// The class defaults would be the wrong values, the level's as the actor has them now are the closest we've got
+		UE_LOG( LogSaveGame, Error, TEXT( "Delta save data for %s was taken against a level snapshot that's %s, properties it left out keep their current values" ),
+			*object->GetName(), snapshot ? TEXT( "out of date" ) : TEXT( "missing" ) );
+		bResetMissing = false;
+	}
+
+	uint16 count = 0;
+	stream.EnterElement() << count;
+
+	TBitArray<> loaded( false, Properties.Num() );
+
+	for ( int32 entry = 0; entry < count; entry++ )
+	{
+		uint16 index = 0;
+		stream.EnterElement() << index;
+
+		if ( index >= Properties.Num() || Ar.IsError() )
+		{
+			UE_LOG( LogSaveGame, Error, TEXT( "Delta save data for %s is corrupt, property %i of %i" ), *object->GetName(), index, Properties.Num() );
+			return false;
+		}
+
+		loaded[index] = true;
+		SaveSchema::SerializeProperty( stream, Properties[index].Property, object );
+	}
+
+	// Whatever the blob left out had the archetype's value when it was saved
+	for ( int32 index = 0; index < Properties.Num() && bResetMissing; index++ )
+	{
+		const void* archetype = loaded[index] ? nullptr : GetArchetypeValue( index, defaults, snapshot );
+
+		if ( archetype )
+		{
+			const FProperty* property = Properties[index].Property;
+			property->CopyCompleteValue( property->ContainerPtrToValuePtr< void >( object ), archetype );
+		}
+	}
+
+	return true;
+}
+
+const void* FGameSerializerClassSchema::GetArchetypeValue( int32 index, const UObject* defaults, const FGameSerializerSnapshot* snapshot ) const
+{
+	if ( snapshot )
+	{
+		return snapshot->GetValue( index );
+	}
+
+	return Properties[index].Property->ContainerPtrToValuePtr< void >( defaults );
+}
+
+TSharedPtr< FGameSerializerSnapshot > FGameSerializerSnapshot::Take( const UObject* object )
+{
+	check( object );
+
+	const UClass* objectClass = object->GetClass();
+	TSharedRef< const FGameSerializerClassSchema > schema = FGameSerializerClassSchema::Get( objectClass );
+
+	if ( schema->SnapshotSize == 0 )
+	{
+		return nullptr;
+	}
+
+	const UObject* defaults = objectClass->GetDefaultObject();
+
+	const bool bDiffers = schema->Properties.ContainsByPredicate( [object, defaults]( const FGameSerializerSchemaProperty& entry )
+	{
+		return entry.SnapshotOffset != INDEX_NONE
+			&& !SaveSchema::IsIdentical( entry.Property, entry.Property->ContainerPtrToValuePtr< void >( object ), entry.Property->ContainerPtrToValuePtr< void >( defaults ) );
+	} );
+
+	if ( !bDiffers )
+	{
+		return nullptr;
+	}
+
+	TSharedPtr< FGameSerializerSnapshot > snapshot = MakeShareable( new FGameSerializerSnapshot( schema, objectClass ) );
+
+	for ( const FGameSerializerSchemaProperty& entry : schema->Properties )
+	{
+		if ( entry.SnapshotOffset != INDEX_NONE )
+		{
+			void* value = snapshot->Data + entry.SnapshotOffset;
+			entry.Property->InitializeValue( value );
+			entry.Property->CopyCompleteValue( value, entry.Property->ContainerPtrToValuePtr< void >( object ) );
+		}
+	}
+
+	return snapshot;
+}
+
+FGameSerializerSnapshot::FGameSerializerSnapshot( const TSharedRef< const FGameSerializerClassSchema >& schema, const UClass* objectClass )
+	: Schema( schema )
+	, Class( const_cast< UClass* >( objectClass ) )
+{
+	Data = (uint8*)FMemory::Malloc( Schema->SnapshotSize, Schema->SnapshotAlignment );
+}
+
+FGameSerializerSnapshot::~FGameSerializerSnapshot()
+{
+	// Strings and arrays in the values own memory, the properties that free it live as long as Class does
+	for ( const FGameSerializerSchemaProperty& entry : Schema->Properties )
+	{
+		if ( entry.SnapshotOffset != INDEX_NONE )
+		{
+			entry.Property->DestroyValue( Data + entry.SnapshotOffset );
+		}
+	}
+
+	FMemory::Free( Data );
+}
+
+const void* FGameSerializerSnapshot::GetValue( int32 index ) const
+{
+	const int32 offset = Schema->Properties[index].SnapshotOffset;
+	return offset != INDEX_NONE ? Data + offset : nullptr;
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+
+#include "AsyncSaveGame.generated.h"
+
+class USavedGameState;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams( FAsyncSaveGameOutputPin, USavedGameState*, Save, bool, bSuccess );
+
+/**
+ * Blueprint node for UGameSaveManager::SaveGameToSlotAsync, fires once the save has hit the disk.
+ */
+UCLASS()
+class GAMESERIALIZER_API UAsyncSaveGameToSlot : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY( BlueprintAssignable )
+		FAsyncSaveGameOutputPin Completed;
+
+	UPROPERTY( BlueprintAssignable )
+		FAsyncSaveGameOutputPin Failed;
+
+	UFUNCTION( BlueprintCallable, Category = "Game Serializer", meta = ( BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject" ) )
+		static UAsyncSaveGameToSlot* AsyncSaveGameToSlot( UObject* WorldContextObject, int32 Slot );
+
+	virtual void Activate() override;
+
+private:
+
+	void HandleSaveComplete( USavedGameState* save, bool bSuccess );
+
+	UPROPERTY( Transient )
+		UObject* WorldContext;
+
+	int32 Slot;
+};
@@ -5,13 +5,27 @@
 #include "CoreMinimal.h"
 #include "Templates/SubclassOf.h"
 #include "GameFramework/Actor.h"
+#include "Engine/World.h"
 
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
 #include "GameFramework/SaveGame.h"
+#include "Async/Future.h"
+
+#include "GameSerializerArchive.h"
+#include "SaveGameManifest.h"
+#include "GameSerializerSettings.h"
 
 #include "Classes.generated.h"
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam( FGameSaveEvent, USaveGame*, save );
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams( FGameSaveCompleteEvent, USaveGame*, save, bool, bSuccess );
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam( FWorldRestoredEvent, FName, WorldID );
+
+class FGameSaveJournal;
+
+/** Native completion callback for async saves, always fired on the game thread. */
+DECLARE_DELEGATE_TwoParams( FGameSaveCompleteDelegate, class USavedGameState*, bool );
 
 namespace SaveTags
 {
@@ -20,6 +34,23 @@ namespace SaveTags
 	static const FName IgnoreTransform = FName( "IgnoreTransform" );
 }
 
+/** How the bytes of a serialized object were produced. */
+UENUM(BlueprintType)
+enum class EGameSerializerBlobEncoding : uint8
+{
+	/** UObject::Serialize with tagged properties. */
+	Tagged,
+
+	/** Untagged SaveGame properties driven by the class's compiled schema, prefixed with the schema hash. */
+	Schema,
+
+	/**
+	 * Only the SaveGame properties that differ from the archetype, by schema index, prefixed with the schema hash and which archetype it was.
+	 * The archetype is the class default object, or for actors placed in a level their state when the level came in.
+	 */
+	Delta,
+};
+
 /**
  * 
  */
@@ -41,6 +72,8 @@ public:
 	{
 		ObjectClass = UObject::StaticClass();
 		UniqueId = NAME_None;
+		bUsesReferenceTable = false;
+		Encoding = EGameSerializerBlobEncoding::Tagged;
 	}
 
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
@@ -51,6 +84,15 @@ public:
 
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
 		TArray< uint8 > Data;
+
+	/** Data stores names and objects as indices into the owning world's (or game state's) reference table. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
+		uint32 bUsesReferenceTable : 1;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
+		EGameSerializerBlobEncoding Encoding;
+
+	SIZE_T GetAllocatedSize() const { return Data.GetAllocatedSize(); }
 };
 
 USTRUCT(BlueprintType)
@@ -66,6 +108,10 @@ public:
 		ActorTransform = FTransform();
 		Data = TArray< uint8 >();
 		bWasSpawned = true;
+		Fingerprint = 0;
+		ArenaOffset = INDEX_NONE;
+		ArenaSize = 0;
+		TransformCodec = EGameSerializerTransformCodec::Full;
 	}
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer)
@@ -80,6 +126,21 @@ public:
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
 		FName AttachmentPoint;
 
+	/** CRC of Data, lets incremental captures and tooling tell whether two blobs match without comparing them. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
+		int32 Fingerprint;
+
+	/** Where the blob sits in its world's ActorArena, INDEX_NONE if it's in Data. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
+		int32 ArenaOffset;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
+		int32 ArenaSize;
+
+	/** How ActorTransform goes out when the world is written, picked by the settings when the actor is captured. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		EGameSerializerTransformCodec TransformCodec;
+
 	static FSerializedActor Null()
 	{
 		FSerializedActor out = FSerializedActor();
@@ -106,10 +167,233 @@ public:
 		uint32 bLoaded : 1;
 
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
-		TMap< FName, FSerializedActor > Actors;
+		TMap< int64, FSerializedActor > Actors;
+
+	/** Names and objects shared by every actor blob in this world. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, SaveGame, Category = Serializer )
+		FGameSerializerReferenceTable References;
+
+	/**
+	 * Every captured actor's blob back to back, actors point into it with ArenaOffset and ArenaSize.
+	 * Identical blobs are only stored once, actors can share a span.
+	 * Not a SaveGame property, the save container writes it after the rest of the world in one piece.
+	 */
+	UPROPERTY( VisibleAnywhere, Category = Serializer )
+		TArray< uint8 > ActorArena;
 
+	/**
+	 * The step the world's quantized locations were decoded with, 0 if none of its records went through quantization.
+	 * Not a SaveGame property, the packed transforms carry it.
+	 */
+	UPROPERTY( VisibleAnywhere, Category = Serializer )
+		double TransformStep = 0.0;
+
+	/** The actor's blob, wherever it's stored. Empty if its span doesn't fit the arena. */
+	TArrayView< const uint8 > GetActorData( const FSerializedActor& actor ) const
+	{
+		if ( actor.ArenaOffset == INDEX_NONE )
+		{
+			return actor.Data;
+		}
+
+		if ( actor.ArenaOffset < 0 || actor.ArenaSize < 0 || actor.ArenaOffset + actor.ArenaSize > ActorArena.Num() )
+		{
+			return TArrayView< const uint8 >();
+		}
+
+		return TArrayView< const uint8 >( ActorArena.GetData() + actor.ArenaOffset, actor.ArenaSize );
+	}
+
+	/** A copy of an actor's record that doesn't need the arena anymore, its blob copied into Data. It still needs References if it uses them. */
+	FSerializedActor DetachActor( const FSerializedActor& actor ) const
+	{
+		FSerializedActor detached = actor;
+
+		if ( actor.ArenaOffset != INDEX_NONE )
+		{
+			detached.Data = TArray< uint8 >( GetActorData( actor ) );
+			detached.ArenaOffset = INDEX_NONE;
+			detached.ArenaSize = 0;
+		}
+
+		return detached;
+	}
+
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T size = Actors.GetAllocatedSize() + ActorArena.GetAllocatedSize() + References.GetAllocatedSize();
+
+		for ( auto&& keypair : Actors )
+		{
+			size += keypair.Value.GetAllocatedSize();
+		}
+
+		return size;
+	}
 };
 
+/** What a capture wrote for one actor class. */
+USTRUCT(BlueprintType)
+struct FGameSerializerClassCaptureStats
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 Actors = 0;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 Bytes = 0;
+};
+
+/** Counters for a single capture, either of one world or summed over a whole save. */
+USTRUCT(BlueprintType)
+struct FGameSerializerCaptureStats
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Actors that went through SaveActor this capture. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 ActorsSerialized = 0;
+
+	/** Unchanged actors whose blob from the previous capture was kept. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 ActorsReused = 0;
+
+	/** Blob bytes of every captured actor, serialized or reused. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 Bytes = 0;
+
+	/** Captured actors whose blob came out identical to one already in their world's arena, they point at that one instead. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 ActorsShared = 0;
+
+	/** Bytes the blobs take in the arenas, every distinct blob counted once. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 ArenaBytes = 0;
+
+	/** Skipped because their class is blacklisted. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 IgnoredBlacklisted = 0;
+
+	/** Skipped because they, or the parent of a child actor, are tagged Ignore. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 IgnoredTagged = 0;
+
+	/** Skipped because their root component is static. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 IgnoredStatic = 0;
+
+	/** Skipped because they aren't tagged Save. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 IgnoredUntagged = 0;
+
+	/** Captured actors by class name. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		TMap< FName, FGameSerializerClassCaptureStats > Classes;
+
+	int32 GetIgnoredCount() const { return IgnoredBlacklisted + IgnoredTagged + IgnoredStatic + IgnoredUntagged; }
+
+	/** Blob bytes per byte actually stored, 1 when nothing was shared. */
+	double GetDedupRatio() const { return ArenaBytes > 0 ? (double)Bytes / ArenaBytes : 1.0; }
+
+	void AddActor( const UClass* actorClass, int64 bytes )
+	{
+		FGameSerializerClassCaptureStats& entry = Classes.FindOrAdd( actorClass ? actorClass->GetFName() : NAME_None );
+		entry.Actors++;
+		entry.Bytes += bytes;
+		Bytes += bytes;
+	}
+
+	FGameSerializerCaptureStats& operator+=( const FGameSerializerCaptureStats& other )
+	{
+		ActorsSerialized += other.ActorsSerialized;
+		ActorsReused += other.ActorsReused;
+		Bytes += other.Bytes;
+		ActorsShared += other.ActorsShared;
+		ArenaBytes += other.ArenaBytes;
+		IgnoredBlacklisted += other.IgnoredBlacklisted;
+		IgnoredTagged += other.IgnoredTagged;
+		IgnoredStatic += other.IgnoredStatic;
+		IgnoredUntagged += other.IgnoredUntagged;
+
+		for ( auto&& keypair : other.Classes )
+		{
+			FGameSerializerClassCaptureStats& entry = Classes.FindOrAdd( keypair.Key );
+			entry.Actors += keypair.Value.Actors;
+			entry.Bytes += keypair.Value.Bytes;
+		}
+
+		return *this;
+	}
+};
+
+/** One line of a FGameSerializerMemoryReport. */
+USTRUCT(BlueprintType)
+struct FGameSerializerMemoryEntry
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		FName Name;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 Bytes = 0;
+
+	/** Actors for worlds and classes, worlds for slots. 0 for worlds that are still encoded. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int32 Count = 0;
+};
+
+/** Heap memory held by the save manager and the serialization managers, see UGameSaveManager::GetMemoryReport. */
+USTRUCT(BlueprintType)
+struct FGameSerializerMemoryReport
+{
+	GENERATED_BODY()
+
+public:
+
+	/** CurrentGameState: worlds of levels out of play, the persistent objects and the player state. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 GameStateBytes = 0;
+
+	/** What every serialization manager holds for its resident level, its previous capture and spare arena included. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 ResidentWorldBytes = 0;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 SessionSaveBytes = 0;
+
+	/** Every save object in SavedGames, header only slots cost next to nothing. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 SavedGamesBytes = 0;
+
+	/** Per world id, resident, decoded or encoded. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		TArray< FGameSerializerMemoryEntry > Worlds;
+
+	/** Actor blobs per class over every decoded world, encoded worlds aren't broken down. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		TArray< FGameSerializerMemoryEntry > Classes;
+
+	/** Per entry of SavedGames. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		TArray< FGameSerializerMemoryEntry > Slots;
+
+	int64 GetTotalBytes() const { return GameStateBytes + ResidentWorldBytes + SessionSaveBytes + SavedGamesBytes; }
+};
+
+/** A world as laid out in its save container section, shared read only between the game state and save snapshots. */
+typedef TSharedPtr< const TArray< uint8 >, ESPMode::ThreadSafe > FEncodedWorldPtr;
+
+/** A decoded world a save snapshot shares read only with the level that owns it. */
+typedef TSharedPtr< const FSerializedWorld, ESPMode::ThreadSafe > FSharedWorldPtr;
+
 USTRUCT(BlueprintType)
 struct FSerializedGameState
 {
@@ -125,6 +409,109 @@ public:
 
 	UPROPERTY( SaveGame, VisibleAnywhere, BlueprintReadOnly )
 		FSerializedActor SavedPlayerState;
+
+	/** Names and objects shared by the persistent objects and the player state. */
+	UPROPERTY( SaveGame, VisibleAnywhere, BlueprintReadOnly )
+		FGameSerializerReferenceTable References;
+
+	/** The world id each level package was last captured under, lets streaming find a level's world before its manager exists. */
+	UPROPERTY( SaveGame, VisibleAnywhere, BlueprintReadOnly )
+		TMap< FName, FName > LevelWorldIds;
+
+	/**
+	 * Worlds still in their encoded form, decoded when a level asks for them. A world in Worlds wins over its entry here.
+	 * Only the save container knows about these, they don't survive UGameplayStatics::SaveGameToMemory.
+	 */
+	TMap< FName, FEncodedWorldPtr > EncodedWorlds;
+
+	/**
+	 * Worlds of levels in play, shared with their ASerializationManager by save snapshots instead of copied.
+	 * A world here wins over its entry in Worlds and EncodedWorlds. Like EncodedWorlds, only the save container knows about these.
+	 */
+	TMap< FName, FSharedWorldPtr > SharedWorlds;
+
+	/** The decoded world saved under an id, shared or not. Null if there's none, or only an encoded one. */
+	const FSerializedWorld* FindDecodedWorld( FName id ) const
+	{
+		if ( const FSharedWorldPtr* shared = SharedWorlds.Find( id ) )
+		{
+			return shared->Get();
+		}
+
+		return Worlds.Find( id );
+	}
+
+	/** Calls func( id, world ) once for every decoded world, the shared ones first. */
+	template< typename FuncType >
+	void ForEachDecodedWorld( FuncType&& func ) const
+	{
+		for ( auto&& keypair : SharedWorlds )
+		{
+			if ( keypair.Value.IsValid() )
+			{
+				func( keypair.Key, *keypair.Value );
+			}
+		}
+
+		for ( auto&& keypair : Worlds )
+		{
+			if ( !SharedWorlds.Contains( keypair.Key ) )
+			{
+				func( keypair.Key, keypair.Value );
+			}
+		}
+	}
+
+	/**
+	 * True the first time countedBuffers sees a buffer shared between states, always true without countedBuffers.
+	 * Lets a report that walks several states count encoded and shared worlds once.
+	 */
+	static bool ShouldCountShared( const void* buffer, TSet< const void* >* countedBuffers )
+	{
+		bool bAlreadyCounted = false;
+
+		if ( countedBuffers )
+		{
+			countedBuffers->Add( buffer, &bAlreadyCounted );
+		}
+
+		return !bAlreadyCounted;
+	}
+
+	/** Encoded and shared worlds are counted in full, unless countedBuffers already saw them. */
+	SIZE_T GetAllocatedSize( TSet< const void* >* countedBuffers = nullptr ) const
+	{
+		SIZE_T size = Worlds.GetAllocatedSize() + PersistentObjects.GetAllocatedSize() + SavedPlayerState.GetAllocatedSize();
+		size += References.GetAllocatedSize() + LevelWorldIds.GetAllocatedSize() + EncodedWorlds.GetAllocatedSize() + SharedWorlds.GetAllocatedSize();
+
+		for ( auto&& keypair : Worlds )
+		{
+			size += keypair.Value.GetAllocatedSize();
+		}
+
+		for ( auto&& keypair : SharedWorlds )
+		{
+			if ( keypair.Value.IsValid() && ShouldCountShared( keypair.Value.Get(), countedBuffers ) )
+			{
+				size += keypair.Value->GetAllocatedSize();
+			}
+		}
+
+		for ( auto&& keypair : PersistentObjects )
+		{
+			size += keypair.Value.GetAllocatedSize();
+		}
+
+		for ( auto&& keypair : EncodedWorlds )
+		{
+			if ( keypair.Value.IsValid() && ShouldCountShared( keypair.Value.Get(), countedBuffers ) )
+			{
+				size += keypair.Value->GetAllocatedSize();
+			}
+		}
+
+		return size;
+	}
 };
 
 UCLASS(BlueprintType)
@@ -158,18 +545,28 @@ public:
 	UPROPERTY( SaveGame, VisibleAnywhere, BlueprintReadOnly )
 		FString SavedMap;
 
+	/** Only filled while the save is being written or loaded, the live state belongs to UGameSaveManager. */
 	UPROPERTY( SaveGame, VisibleAnywhere, BlueprintReadOnly )
 		FSerializedGameState SavedState;
 
 	UPROPERTY(SaveGame, VisibleAnywhere, BlueprintReadWrite, Category = Save)
 		FString SavedGameOptions;
+
+	/** True if only the slot header was read from the manifest, the payload is loaded once the slot is opened. */
+	UPROPERTY( Transient, VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		uint32 bHeaderOnly : 1;
 	
 	/*UPROPERTY( SaveGame, VisibleAnywhere, BlueprintReadOnly )
 		TMap< FName, FSerializedWorld > SavedWorlds;*/
+
+	/** Heap memory held by the state and thumbnail, see FSerializedGameState::GetAllocatedSize for countedBuffers. */
+	SIZE_T GetAllocatedSize( TSet< const void* >* countedBuffers = nullptr ) const { return SavedState.GetAllocatedSize( countedBuffers ) + ScreenshotPixels.GetAllocatedSize(); }
+
+	virtual void GetResourceSizeEx( FResourceSizeEx& CumulativeResourceSize ) override;
 };
 
 UCLASS(BlueprintType)
-class GAMESERIALIZER_API UGameSaveManager : public UGameInstanceSubsystem
+class GAMESERIALIZER_API UGameSaveManager : public UGameInstanceSubsystem, public FTickableGameObject
 {
 	GENERATED_BODY()
 
@@ -193,6 +590,7 @@ public:
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly )
 		TArray< USavedGameState* > SavedGames;
 
+	/** Worlds of levels that aren't in play, resident levels keep theirs in their ASerializationManager. */
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly )
 		FSerializedGameState CurrentGameState;
 
@@ -204,6 +602,10 @@ public:
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly )
 		TArray< UObject* > PersistentObjects;
 
+	/** Counters from the most recent CacheWorld, summed over every serialization manager. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly )
+		FGameSerializerCaptureStats LastCaptureStats;
+
 	UPROPERTY( BlueprintAssignable, Category = Game )
 		FGameSaveEvent OnNewGame;
 
@@ -213,6 +615,14 @@ public:
 	UPROPERTY( BlueprintAssignable, Category = Saving )
 		FGameSaveEvent OnLoad;
 
+	/** Fired once a save has actually been written to disk (or failed to), after OnSave. */
+	UPROPERTY( BlueprintAssignable, Category = Saving )
+		FGameSaveCompleteEvent OnSaveComplete;
+
+	/** Fired when a serialization manager has finished applying its world's save data, which can take several frames with a restore budget. */
+	UPROPERTY( BlueprintAssignable, Category = Saving )
+		FWorldRestoredEvent OnWorldRestored;
+
 		FDelegateHandle ActorLoadBinding;
 
 	virtual void Initialize( FSubsystemCollectionBase& Collection ) override;
@@ -220,20 +630,7 @@ public:
 	virtual void Deinitialize() override;
 	
 	UFUNCTION( BlueprintPure )
-	USavedGameState* GetCurrentSave()
-	{
-		if ( SavedGames.Num() <= 0 )
-		{
-			SavedGames = GetSaves();
-		}
-
-		if ( SavedGames.Num() <= 0 || !SavedGames.IsValidIndex( CurrentSlot ) )
-		{
-			return nullptr;
-		}
-
-		return SavedGames[CurrentSlot];
-	}
+		USavedGameState* GetCurrentSave();
 
 	UFUNCTION( BlueprintPure )
 		USavedGameState* GetSaveAtSlot( int32 slot );
@@ -242,6 +639,26 @@ public:
 	UFUNCTION( BlueprintPure )
 		FSerializedWorld GetWorldState( FName Id, bool& success );
 
+	/** The world's data without copying it, whether its level is resident or not, decoding it if needed. Don't hold on to it past the current frame. */
+	const FSerializedWorld* FindWorldState( FName Id );
+
+	/** True if the game state knows the world at all, without decoding it. */
+	bool HasWorldState( FName Id ) const;
+
+	/**
+	 * Decodes a world on a worker and loads the classes it references, so its manager only has to apply it in BeginPlay.
+	 * Streaming levels are prefetched on their own as soon as they start loading.
+	 */
+	UFUNCTION( BlueprintCallable )
+		void PrefetchWorldState( FName WorldID );
+
+	/** True once a prefetched world is decoded and waiting for its level. */
+	UFUNCTION( BlueprintPure )
+		bool IsWorldStatePrefetched( FName WorldID ) const;
+
+	/** Moves a world's data out of the game state, the caller owns it until it's handed back through CacheWorldState. */
+	FSerializedWorld TakeWorldState( FName Id );
+
 	FSerializedWorld GetWorldState( FName Id ) { bool success = false; return GetWorldState( Id, success ); }
 
 	UFUNCTION( BlueprintCallable )
@@ -249,14 +666,75 @@ public:
 
 	UFUNCTION( BlueprintCallable )
 		virtual void LoadGameFromSlot( int32 index, bool bOpenLevel = true );
-	void SaveSessionToSaveObject(USavedGameState* saveFile);
+	/** Snapshots the session into a save object, bCaptureWorlds can be false if every serialization manager was just captured. */
+	void SaveSessionToSaveObject(USavedGameState* saveFile, bool bCaptureWorlds = true);
+
+	/** Copies the persistent objects, the player state, the map, time and player transform into a save object. */
+	void CaptureSessionHeader( USavedGameState* saveFile );
+
+	/**
+	 * Puts every world into a save object without copying them: encoded worlds and resident ones (in SavedState.SharedWorlds) are shared read only.
+	 * Only decoded worlds that have no encoded copy are copied.
+	 */
+	void CaptureWorldStates( USavedGameState* saveFile );
 
 	UFUNCTION( BlueprintCallable )
 		void SaveGameToSlot( int32 index );
 
+	/**
+	 * Captures the world on the game thread, then serializes and writes the save on a worker.
+	 * Requests for a slot that is already queued behind an in-flight write are coalesced into that one follow-up write.
+	 */
+	TFuture< bool > SaveGameToSlotAsync( int32 index, FGameSaveCompleteDelegate onComplete = FGameSaveCompleteDelegate(), bool bAmortizeCapture = false );
+
+	/**
+	 * Saves like SaveGameToSlot, but spreads the world capture over several frames using CaptureBudgetMs from the settings.
+	 * Each world is captured as it was when the save started, as long as game code calls PreModifyActor before changing actors.
+	 */
+	UFUNCTION( BlueprintCallable )
+		void SaveGameToSlotAmortized( int32 index );
+
+	/** True from the start of a save's capture until it has been written. */
+	UFUNCTION( BlueprintPure )
+		bool IsSaveInProgress() const { return InFlightSave.IsSet(); }
+
+	/** True while a serialization manager is still spreading its world's restore over frames. */
+	UFUNCTION( BlueprintPure )
+		bool IsRestoringWorlds() const;
+
+	/** Lets an amortized capture grab the actor before it changes, call right before modifying or destroying a saved actor. */
+	void PreModifyActor( AActor* actor );
+
+	// FTickableGameObject
+	virtual void Tick( float DeltaTime ) override;
+	virtual bool IsTickable() const override { return bAmortizedCaptureRunning; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT( UGameSaveManager, STATGROUP_Tickables ); }
+
+	/**
+	 * Serializes a save object and writes it to a slot. Safe to call off the game thread as long as nothing mutates the save object meanwhile.
+	 * Fills the file related fields of outInfo if given. With a journal only what changed since its last write gets appended, see FGameSaveJournal.
+	 */
+	static bool WriteSaveToSlot( USavedGameState* saveFile, const FString& slotName, FGameSaveSlotInfo* outInfo = nullptr, FGameSaveJournal* journal = nullptr );
+
+	/** Where the serializer's memory is: per world, per actor class and per slot. Walks every decoded world, not meant for every frame. */
+	UFUNCTION( BlueprintCallable )
+		FGameSerializerMemoryReport GetMemoryReport() const;
+
+	/** Prints GetMemoryReport, backs the GameSerializer.MemReport console command. */
+	void DumpMemoryReport( FOutputDevice& Ar ) const;
+
+	virtual void GetResourceSizeEx( FResourceSizeEx& CumulativeResourceSize ) override;
+
+	/** Returns a save per slot, slots that haven't been opened yet are header only. */
 	UFUNCTION( BlueprintPure )
 		TArray< USavedGameState* > GetSaves();
 
+	/** Slot headers straight from the manifest, never touches the slot files. */
+	UFUNCTION( BlueprintPure )
+		TArray< FGameSaveSlotInfo > GetSaveSlots();
+
 	UFUNCTION(BlueprintCallable)
 		void CreateSessionSave();
 	
@@ -273,20 +751,38 @@ protected:
 
 	virtual USavedGameState* CreateSaveGame(FName NameOverride = NAME_None);
 
+	/** Loads the manifest for the current prefix, rebuilding it from the slot files if it's missing. */
+	const FGameSaveManifest& GetManifest();
+
+	/** Records a freshly written slot in the manifest and persists it. */
+	void UpdateManifest( int32 index, const USavedGameState* saveFile, const FGameSaveSlotInfo& fileInfo );
+
+	FGameSaveManifest Manifest;
+
+	/** Writers of journaled slots by slot name, each knows what its slot's checkpoint and journal hold. */
+	TMap< FString, TSharedPtr< FGameSaveJournal, ESPMode::ThreadSafe > > Journals;
+
 public:
 
-	virtual void LoadWorldState( FSerializedGameState state );
+	/** Takes over a loaded game state, bRestoreResidentWorlds reapplies it to the levels already in play. */
+	virtual void LoadWorldState( FSerializedGameState&& state, bool bRestoreResidentWorlds = true );
 
-	void LoadPersistentObjects( FSerializedGameState state );
+	/** Reconciles PersistentObjects with CurrentGameState, reusing objects with a matching id and creating only the missing ones. */
+	void LoadPersistentObjects();
 
-	virtual FSerializedGameState CacheWorld();
+	/** Captures every resident world, the persistent objects and the player state. */
+	virtual void CacheWorld();
+
+	/** Captures the persistent objects and the player state into CurrentGameState. */
+	virtual void CachePersistentState();
 
 	virtual void GatherWorldStates();
 
-	virtual void CacheWorldState( FName worldId, FSerializedWorld world )
-	{
-		CurrentGameState.Worlds.Add( worldId, world );
-	}
+	/**
+	 * Hands a world's data back to the game state once its level leaves play, where it's kept encoded.
+	 * An unchanged world just drops back to the encoded copy it was decoded from.
+	 */
+	virtual void CacheWorldState( FName worldId, FSerializedWorld&& world, bool bDirty = true );
 
 	
 	virtual void CachePersistentObject( UObject* object );
@@ -294,9 +790,131 @@ public:
 	virtual void ReleasePersistentObject( UObject* object );
 
 	
+	/** Flags an actor as changed, incremental captures will re-serialize it instead of reusing its last blob. */
+	void MarkActorDirty( AActor* actor );
+
+	/** Returns whether the actor was marked dirty since its last capture and clears the mark. */
+	bool ConsumeActorDirty( AActor* actor );
+
+	/** Called for every actor spawned into one of our worlds, routes it into its level's registry. */
 	virtual void LoadedActor( AActor* actor );
 
+	/** Called for every actor destroyed in one of our worlds. */
 	virtual void UnloadedActor( AActor* actor );
+
+	void RegisterSerializationManager( class ASerializationManager* manager );
+
+	void UnregisterSerializationManager( class ASerializationManager* manager );
+
+	class ASerializationManager* FindSerializationManager( const ULevel* level ) const;
+
+	/** Every serialization manager whose level is currently in play. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Transient )
+		TArray< class ASerializationManager* > SerializationManagers;
+
+protected:
+
+	void HandleWorldInitialized( UWorld* world, const UWorld::InitializationValues values );
+
+	void HandleWorldCleanup( UWorld* world, bool bSessionEnded, bool bCleanupResources );
+
+	void HandleLevelStreamingStateChanged( UWorld* world, const ULevelStreaming* streamingLevel, ULevel* levelIfLoaded, ELevelStreamingState previousState, ELevelStreamingState newState );
+
+	/** The world id a level package was saved under, NAME_None if it never was. */
+	FName FindWorldIdForLevel( const FString& packageName ) const;
+
+	/** Hooks the spawn and destroy notifications of a world owned by our game instance. */
+	void BindWorld( UWorld* world );
+
+	struct FWorldBindings
+	{
+		FDelegateHandle Spawned;
+		FDelegateHandle Destroyed;
+	};
+
+	TMap< TObjectKey< UWorld >, FWorldBindings > WorldBindings;
+
+	FDelegateHandle WorldCleanupBinding;
+
+	FDelegateHandle LevelStreamingBinding;
+
+private:
+
+	struct FPendingSave
+	{
+		int32 Slot = 0;
+		bool bAmortizeCapture = false;
+		TArray< FGameSaveCompleteDelegate > Callbacks;
+		TArray< TSharedRef< TPromise< bool > > > Promises;
+	};
+
+	void StartSaveWrite( FPendingSave&& request );
+
+	/** Writes the captured save object, on a worker unless the settings say otherwise. */
+	void WriteCapturedSave( USavedGameState* saveFile );
+
+	void FinishAmortizedCapture();
+
+	/** Tells everyone waiting on a save that will never be written that it failed. */
+	void FailSave( const FPendingSave& save, USavedGameState* saveFile );
+
+	/**
+	 * Gets the save in flight onto disk before the game state it was taken from is replaced: its capture is finished in one go and its write waited for.
+	 * Saves still queued behind it would capture the replaced state, they fail.
+	 */
+	void FlushInFlightSave();
+
+	struct FWorldPrefetch
+	{
+		/** The encoded world being decoded, the result is stale once the game state holds a different one. */
+		FEncodedWorldPtr Source;
+
+		TSharedPtr< FSerializedWorld, ESPMode::ThreadSafe > Result;
+
+		bool bReady = false;
+	};
+
+	TMap< FName, FWorldPrefetch > WorldPrefetches;
+
+	/** Decodes on the thread pool, bRetry is set once the missing classes were loaded and the world is decoded again. */
+	void DecodePrefetch( FName worldId, FEncodedWorldPtr source, bool bRetry );
+
+	void FinishPrefetch( FName worldId, FEncodedWorldPtr source, TSharedPtr< FSerializedWorld, ESPMode::ThreadSafe > result, TArray< FString >&& missingObjects, bool bSuccess, bool bRetry );
+
+	/** Hands over a finished prefetch of the game state's current encoded world, and forgets any other. */
+	bool ConsumePrefetch( FName worldId, FSerializedWorld& outWorld );
+
+	/** Drops the worlds FindWorldState decoded next to their encoded copy, the next lookup decodes them again. */
+	void ReleaseDecodedWorlds();
+
+	/** Managers the running amortized capture hasn't finished with yet. */
+	TArray< TWeakObjectPtr< class ASerializationManager > > CapturingManagers;
+
+	bool bAmortizedCaptureRunning = false;
+
+	/** What a write came back with. */
+	struct FSaveWriteResult
+	{
+		bool bSuccess = false;
+
+		/** The slot's file info, the manifest entry is filled in from it on the game thread. */
+		FGameSaveSlotInfo FileInfo;
+	};
+
+	void FinishSaveWrite( USavedGameState* saveFile, const FSaveWriteResult& result );
+
+	TOptional< FPendingSave > InFlightSave;
+
+	TArray< FPendingSave > QueuedSaves;
+
+	TSet< TObjectKey< AActor > > DirtyActors;
+
+	/** The write running on a worker, Deinitialize waits for it before the save object can go away. */
+	TFuture< FSaveWriteResult > InFlightWrite;
+
+	/** The save object being written, kept alive while a worker reads it and only put in SavedGames once it's on disk. */
+	UPROPERTY( Transient )
+		USavedGameState* InFlightSaveObject;
 };
 
 class ISerializationCore
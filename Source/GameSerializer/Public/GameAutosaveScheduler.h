@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+
+#include "GameAutosaveScheduler.generated.h"
+
+class UGameSaveManager;
+class USaveGame;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam( FGameAutosaveEvent, int32, Slot );
+
+/**
+ * Saves the game through the UGameSaveManager on an interval, at a moment that can afford it:
+ * never while game code holds a block (combat, cinematics), never within the minimum spacing of the last save,
+ * never while a save is still being captured or written or a world is still being restored,
+ * and only once the last few frames left enough of the frame budget free for the capture.
+ * Configured under Autosave in the Game Serializer settings.
+ */
+UCLASS()
+class GAMESERIALIZER_API UGameAutosaveScheduler : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize( FSubsystemCollectionBase& Collection ) override;
+
+	virtual void Deinitialize() override;
+
+	/** Holds autosaves off until every block with this reason is released, blocks with the same reason nest. */
+	UFUNCTION( BlueprintCallable, Category = Autosave )
+		void BlockAutosave( FName Reason );
+
+	UFUNCTION( BlueprintCallable, Category = Autosave )
+		void UnblockAutosave( FName Reason );
+
+	UFUNCTION( BlueprintPure, Category = Autosave )
+		bool IsAutosaveBlocked() const { return Blocks.Num() > 0; }
+
+	/** Autosaves as soon as it's allowed to, without waiting for the interval. Still respects blocks, spacing and frame budget. */
+	UFUNCTION( BlueprintCallable, Category = Autosave )
+		void RequestAutosave();
+
+	/** Turns the interval on or off for this session, RequestAutosave works either way. */
+	UFUNCTION( BlueprintCallable, Category = Autosave )
+		void SetAutosaveEnabled( bool bEnabled );
+
+	/** Seconds until the interval is up, 0 if an autosave is already due. */
+	UFUNCTION( BlueprintPure, Category = Autosave )
+		float GetTimeUntilAutosave() const;
+
+	/** Fired on the frame an autosave starts capturing. */
+	UPROPERTY( BlueprintAssignable, Category = Autosave )
+		FGameAutosaveEvent OnAutosaveStarted;
+
+	// FTickableGameObject
+	virtual void Tick( float DeltaTime ) override;
+	virtual bool IsTickable() const override { return bEnabled || bRequested; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override { RETURN_QUICK_DECLARE_CYCLE_STAT( UGameAutosaveScheduler, STATGROUP_Tickables ); }
+
+protected:
+
+	/** Any save resets the interval, manual ones included. */
+	UFUNCTION()
+		void HandleSaveComplete( USaveGame* save, bool bSuccess );
+
+	/** Why an autosave that's due can't start this frame, nullptr if it can. bIgnoreFrameBudget leaves out the frame costs. */
+	const TCHAR* GetDeferReason( bool bIgnoreFrameBudget = false ) const;
+
+	void StartAutosave();
+
+	UPROPERTY()
+		UGameSaveManager* SaveManager;
+
+	/** Number of holds per reason. */
+	TMap< FName, int32 > Blocks;
+
+	/** Game thread milliseconds of the most recent frames, idle time waiting on vsync or the frame rate limit left out. */
+	TArray< float > RecentFrameMs;
+
+	double LastSaveTime = 0.0;
+
+	/** What the last autosave cost the game thread on the frame it started, a frame needs that much room for the next one. */
+	float LastCaptureMs = 0.f;
+
+	/** When the current autosave became due, 0 if none is. */
+	double DueSince = 0.0;
+
+	bool bEnabled = false;
+
+	bool bRequested = false;
+};
@@ -0,0 +1,225 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USavedGameState;
+class IMappedFileHandle;
+class IMappedFileRegion;
+struct FSerializedWorld;
+struct FSerializedGameState;
+struct FGameSaveSlotInfo;
+
+/** One entry of a container's table of contents, offsets are from the start of the file. */
+struct GAMESERIALIZER_API FGameSaveContainerSection
+{
+	FString Name;
+
+	int64 Offset = 0;
+
+	/** Bytes the section takes up in the file. */
+	int64 Size = 0;
+
+	/** Bytes once decompressed, the same as Size for stored sections. */
+	int64 RawSize = 0;
+
+	/** FCompression format of the section's blocks, NAME_None if it's stored as is. */
+	FName Compression;
+
+	/** Raw bytes per compressed block, only the last block is smaller. */
+	int32 BlockSize = 0;
+
+	bool IsCompressed() const { return !Compression.IsNone(); }
+
+	friend FArchive& operator<<( FArchive& Ar, FGameSaveContainerSection& section )
+	{
+		Ar << section.Name;
+		Ar << section.Offset;
+		Ar << section.Size;
+		Ar << section.RawSize;
+		Ar << section.Compression;
+		Ar << section.BlockSize;
+		return Ar;
+	}
+};
+
+/** Sizes and time spent compressing while writing a container, or decompressing while reading one. */
+struct GAMESERIALIZER_API FGameSaveContainerStats
+{
+	int64 RawSize = 0;
+
+	int64 StoredSize = 0;
+
+	double Seconds = 0.0;
+
+	double GetRatio() const { return RawSize > 0 ? (double)StoredSize / (double)RawSize : 1.0; }
+};
+
+/**
+ * On disk layout of a save slot: a header and table of contents followed by sections that can be read on their own
+ * (metadata, thumbnail, one per world, persistent objects, player state), so a load only touches what it needs.
+ * The slot file is memory mapped when the save system is file backed, and read in one go otherwise.
+ * Slots written before the container existed are detected and still load through UGameplayStatics.
+ * Checkpoints of a journaled slot have their FGameSaveJournal replayed over them when opened, readers only ever see the result.
+ */
+class GAMESERIALIZER_API FGameSaveContainer
+{
+public:
+
+	static const TCHAR* MetadataSection;
+	static const TCHAR* ThumbnailSection;
+	static const TCHAR* PersistentObjectsSection;
+	static const TCHAR* PlayerStateSection;
+	static const TCHAR* ReferencesSection;
+	static const TCHAR* LevelsSection;
+
+	/** Id of the slot's journal and how many of its records the checkpoint holds, only in slots written by a FGameSaveJournal. */
+	static const TCHAR* JournalSection;
+
+	static FString GetWorldSectionName( FName worldId );
+
+	/** Where the generic save system keeps a slot, the only place a slot can be mapped from. Meaningless unless IsSlotFileBacked. */
+	static FString GetSlotFilePath( const FString& slotName );
+
+	/** True if slots go through the generic save system, as plain files at GetSlotFilePath that can be mapped and journaled. */
+	static bool IsSlotFileBacked();
+
+	/**
+	 * Writes a file through a flushed temporary next to it, then moves that over the file.
+	 * A crash leaves the old file, the new one, or only the temporary, which RecoverFile puts in place.
+	 */
+	static bool ReplaceFile( const FString& path, TArrayView< const uint8 > bytes );
+
+	/** Finishes a ReplaceFile that was cut short between deleting the old file and moving the temporary over. */
+	static void RecoverFile( const FString& path );
+
+	/**
+	 * Lays a save object out as a container, fills the sizes and thumbnail location of outInfo.
+	 * Sections are compressed as UGameSerializerSettings asks for. A valid journalId marks the container as a checkpoint
+	 * that already holds the first journalRecords records of that journal.
+	 */
+	static bool Write( USavedGameState* save, TArray< uint8 >& outBytes, FGameSaveSlotInfo* outInfo = nullptr, FGameSaveContainerStats* outStats = nullptr, const FGuid& journalId = FGuid(), int32 journalRecords = 0 );
+
+	/** Write for sections that were already built, it doesn't touch any object so it can run on any thread. */
+	static bool WriteSections( const FString& saveClassPath, TArray< FString > names, TArray< TArray< uint8 > > payloads, TArray< uint8 >& outBytes, FGameSaveSlotInfo* outInfo = nullptr, FGameSaveContainerStats* outStats = nullptr, const FGuid& journalId = FGuid(), int32 journalRecords = 0 );
+
+	/** The uncompressed sections of a save object, in the order Write lays them out. */
+	static void BuildSections( USavedGameState* save, bool bIncludeWorlds, TArray< FString >& outNames, TArray< TArray< uint8 > >& outPayloads );
+
+	/**
+	 * Opens a slot for reading, null if it doesn't exist or is neither a container nor a legacy save.
+	 * Without bReplayJournal the sections are the checkpoint's as written, which is all a header for the manifest needs.
+	 */
+	static TUniquePtr< FGameSaveContainer > Open( const FString& slotName, bool bReplayJournal = true );
+
+	/** Reads a whole slot into a new save object, worlds are left in SavedState.EncodedWorlds unless bDecodeWorlds. */
+	static USavedGameState* LoadSave( const FString& slotName, bool bDecodeWorlds = true );
+
+	/**
+	 * The bytes of a world section: a header with its version, the world minus its actors' transforms, the arena,
+	 * then the transforms packed by FGameSerializerTransformCodec.
+	 */
+	static void EncodeWorld( const FSerializedWorld& world, TArray< uint8 >& outBytes );
+
+	/**
+	 * Decodes a world section, patches appended to it are applied on the way. With outMissingObjects it never loads anything,
+	 * so it can run off the game thread under a GC guard, and references to objects that aren't loaded yet are left null and listed instead.
+	 */
+	static bool DecodeWorld( TArrayView< const uint8 > bytes, FSerializedWorld& outWorld, TArray< FString >* outMissingObjects = nullptr );
+
+	/**
+	 * Appends a patch that takes a world from what it was to what it is now: the reference table entries past baseNames and basePaths,
+	 * the changed actors with their full transform and codec, and the removed ones. Only valid on top of a world whose table had exactly
+	 * baseNames and basePaths entries.
+	 */
+	static void EncodeWorldPatch( const FSerializedWorld& world, int32 baseNames, int32 basePaths, TConstArrayView< int64 > changedActors, TConstArrayView< int64 > removedActors, TArray< uint8 >& outBytes );
+
+	~FGameSaveContainer();
+
+	/** A slot written by UGameplayStatics::SaveGameToSlot, it has no sections and only loads as a whole. */
+	bool IsLegacy() const { return bLegacy; }
+
+	bool IsMapped() const { return MappedRegion.IsValid(); }
+
+	/** The slot file and its journal. */
+	int64 GetTotalSize() const { return Bytes.Num() + JournalSize; }
+
+	const TArray< FGameSaveContainerSection >& GetSections() const { return Sections; }
+
+	const FGameSaveContainerSection* FindSection( const FString& name ) const;
+
+	/**
+	 * Points straight into the mapped file for stored sections, compressed ones are inflated into scratch.
+	 * Sections the journal replaced point into the container, patched ones are put together in scratch.
+	 * Only valid while the container is open and scratch is around.
+	 */
+	TArrayView< const uint8 > GetSectionData( const FString& name, TArray< uint8 >& scratch ) const;
+
+	/** Everything decompressed by this container so far. */
+	const FGameSaveContainerStats& GetReadStats() const { return ReadStats; }
+
+	TArray< FName > GetWorldIds() const;
+
+	/** Creates the save object from the metadata section alone, its state and thumbnail stay empty. */
+	USavedGameState* ReadHeader() const;
+
+	bool ReadThumbnail( TArray< FColor >& outPixels ) const;
+
+	bool ReadWorld( FName worldId, FSerializedWorld& outWorld ) const;
+
+	/** Every world, the persistent objects and the player state. Worlds are only copied out as encoded buffers unless bDecodeWorlds. */
+	bool ReadState( FSerializedGameState& outState, bool bDecodeWorlds = true ) const;
+
+	/** The save object with everything in it. */
+	USavedGameState* ReadSave( bool bDecodeWorlds = true ) const;
+
+private:
+
+	FGameSaveContainer();
+
+	/** Reads the header and table of contents, rejects anything that doesn't fit the file. */
+	bool Parse();
+
+	/** Replays the slot's journal over the sections, if the slot is a journaled checkpoint and its journal belongs to it. */
+	void ApplyJournal( const FString& slotName );
+
+	/** A section as the slot file has it. */
+	TArrayView< const uint8 > GetStoredSectionData( const FString& name, TArray< uint8 >& scratch ) const;
+
+	/** What the journal did to a section. */
+	struct FJournaledSection
+	{
+		/** Replaces the stored section when bReplaced. */
+		TArray< uint8 > Data;
+
+		/** World patches to append to the section, in the order they were journaled. */
+		TArray< uint8 > Patches;
+
+		bool bReplaced = false;
+
+		bool bRemoved = false;
+	};
+
+	TMap< FString, FJournaledSection > JournaledSections;
+
+	/** Committed bytes of the journal that was replayed, or the journal file's size when it wasn't. */
+	int64 JournalSize = 0;
+
+	TUniquePtr< IMappedFileHandle > MappedFile;
+
+	TUniquePtr< IMappedFileRegion > MappedRegion;
+
+	/** The slot's contents when it couldn't be mapped. */
+	TArray< uint8 > OwnedBytes;
+
+	TArrayView< const uint8 > Bytes;
+
+	TArray< FGameSaveContainerSection > Sections;
+
+	FString SaveClassPath;
+
+	bool bLegacy = false;
+
+	mutable FGameSaveContainerStats ReadStats;
+};
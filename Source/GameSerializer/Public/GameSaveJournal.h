@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Classes.h"
+#include "Async/Future.h"
+#include "HAL/CriticalSection.h"
+
+class USavedGameState;
+struct FGameSaveSlotInfo;
+
+enum class EGameSaveJournalOp : uint8
+{
+	/** The section's bytes, instead of the checkpoint's. */
+	Replace,
+
+	/** A world patch to append to the section, see FGameSaveContainer::EncodeWorldPatch. */
+	Patch,
+
+	/** The section is gone. */
+	Remove,
+};
+
+/** One change of a committed journal record. */
+struct GAMESERIALIZER_API FGameSaveJournalEntry
+{
+	EGameSaveJournalOp Op = EGameSaveJournalOp::Replace;
+
+	FString Section;
+
+	TArray< uint8 > Data;
+};
+
+/**
+ * Journaled writes of a single slot. The slot file is a checkpoint, saves after it only append what changed to a journal file
+ * next to it: sections that changed as a whole, and a patch of the changed and removed actors for worlds that are decoded.
+ * Each record is followed by a CRC and a commit marker and flushed to disk before the save counts as written,
+ * a record that didn't make it whole is ignored when the journal is replayed.
+ *
+ * A journal past its limits is compacted in the background: the save is written whole as a new checkpoint that notes how many
+ * records it already holds, moved over the slot file, and only then are those records dropped from the journal.
+ * Replay skips the records a checkpoint holds, so a crash anywhere in between still loads the latest save.
+ *
+ * Only the writer of a slot keeps one of these, it remembers what the checkpoint and the journal hold so far.
+ * Slots that aren't plain files keep getting written whole.
+ */
+class GAMESERIALIZER_API FGameSaveJournal
+{
+public:
+
+	explicit FGameSaveJournal( const FString& slotName );
+
+	/** Waits for a compaction that's still running. */
+	~FGameSaveJournal();
+
+	static FString GetJournalFilePath( const FString& slotName );
+
+	/**
+	 * Reads the committed entries of a slot's journal in the order they were written, past the first checkpointRecords records
+	 * the checkpoint already holds. False if there is no journal journalId, or it no longer has every record the checkpoint lacks.
+	 * outSize gets the bytes up to the last committed record.
+	 */
+	static bool Read( const FString& slotName, const FGuid& journalId, int32 checkpointRecords, TArray< FGameSaveJournalEntry >& outEntries, int64* outSize = nullptr );
+
+	static void Delete( const FString& slotName );
+
+	/**
+	 * Writes a save to the slot, as a journal record if there's a checkpoint to append to and the journal stays within its limits.
+	 * Fills the file related fields of outInfo like FGameSaveContainer::Write. Not thread safe, one write per slot at a time.
+	 */
+	bool Write( USavedGameState* save, FGameSaveSlotInfo* outInfo = nullptr, int64* outBytesWritten = nullptr );
+
+	int64 GetJournalSize() const;
+
+private:
+
+	/** What the checkpoint and the journal hold of a world, enough to tell what changed since. */
+	struct FWorldBaseline
+	{
+		/** The world went out encoded, it's unchanged as long as the snapshot still shares the Encoded buffer. */
+		bool bEncoded = false;
+
+		TWeakPtr< const TArray< uint8 >, ESPMode::ThreadSafe > Encoded;
+
+		/** Hash of every actor's record and blob, by id. */
+		TMap< int64, uint64 > Actors;
+
+		TArray< FName > Names;
+
+		TArray< FString > ObjectPaths;
+
+		bool bLoaded = false;
+	};
+
+	/** Counts for the log. */
+	struct FDeltaStats
+	{
+		int32 Sections = 0;
+		int32 PatchedWorlds = 0;
+		int32 ChangedActors = 0;
+		int32 RemovedActors = 0;
+	};
+
+	/** Hashes what the save holds, and with outEntries what changed since the baseline. */
+	void BuildDelta( USavedGameState* save, TArray< FGameSaveJournalEntry >* outEntries, TMap< FString, uint64 >& outSections, TMap< FName, FWorldBaseline >& outWorlds, FDeltaStats& outStats ) const;
+
+	/** Writes the save whole, with a new journal id, and starts an empty journal for it. Waits for a running compaction first. */
+	bool WriteCheckpoint( USavedGameState* save, FGameSaveSlotInfo* outInfo, int64* outBytesWritten );
+
+	/** Builds the save's sections now, and leaves compressing and writing them as a checkpoint to a worker. */
+	void StartCompaction( USavedGameState* save );
+
+	/** Runs on the worker, journalRecords and journalOffset are the records the sections hold and where they end in the journal. */
+	void Compact( const FString& saveClassPath, TArray< FString > names, TArray< TArray< uint8 > > payloads, const FGuid& journalId, int32 journalRecords, int64 journalOffset );
+
+	bool IsCompacting() const { return Compaction.IsValid() && !Compaction.IsReady(); }
+
+	/** Appends bytes to the journal file and flushes them to disk. */
+	bool AppendFile( const TArray< uint8 >& bytes ) const;
+
+	FString SlotName;
+
+	/** Invalid until a checkpoint with a journal is on disk, saves get written whole until then. */
+	FGuid JournalId;
+
+	/** Records ever appended to the journal, the ones compacted away included. */
+	int32 RecordCount = 0;
+
+	/** The last record that replaced the thumbnail, the checkpoint's thumbnail is stale while the journal still has it. */
+	int32 ThumbnailRecord = INDEX_NONE;
+
+	int64 CheckpointSize = 0;
+
+	int64 CheckpointRawSize = 0;
+
+	int64 ThumbnailOffset = INDEX_NONE;
+
+	int64 ThumbnailSize = 0;
+
+	/** Bytes in the journal file, its header included. */
+	int64 JournalSize = 0;
+
+	/** Hash of every section that isn't a world. */
+	TMap< FString, uint64 > Sections;
+
+	TMap< FName, FWorldBaseline > Worlds;
+
+	TFuture< void > Compaction;
+
+	/** Guards the files and the sizes, which the compaction updates once it's done. */
+	mutable FCriticalSection Lock;
+};
@@ -13,4 +13,7 @@ public:
 	virtual void ShutdownModule() override;
 };
 
-DECLARE_LOG_CATEGORY_EXTERN(LogSaveGame, Log, All);
\ No newline at end of file
+DECLARE_LOG_CATEGORY_EXTERN(LogSaveGame, Log, All);
+
+/** Per actor and per object messages, silent unless raised with "log LogSaveGameDetail Verbose". Captures summarize into LogSaveGame instead. */
+DECLARE_LOG_CATEGORY_EXTERN(LogSaveGameDetail, Warning, All);
\ No newline at end of file
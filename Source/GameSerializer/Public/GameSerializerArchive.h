@@ -3,7 +3,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Serialization/ArchiveProxy.h"
 #include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/ObjectKey.h"
+
+#include "GameSerializerArchive.generated.h"
 
 /**
  * 
@@ -16,3 +20,88 @@ struct GAMESERIALIZER_API FGameSerializerArchive : public FObjectAndNameAsString
 		ArIsSaveGame = true;
 	}
 };
+
+/**
+ * Names and object paths referenced by a group of blobs, each stored once.
+ * Blobs written through FGameSerializerTableArchive hold indices into this instead of strings.
+ */
+USTRUCT(BlueprintType)
+struct GAMESERIALIZER_API FGameSerializerReferenceTable
+{
+	GENERATED_BODY()
+
+public:
+
+	FGameSerializerReferenceTable() = default;
+
+	/** Copies only the entries, the lookups are rebuilt as the copy needs them. */
+	FGameSerializerReferenceTable( const FGameSerializerReferenceTable& other );
+	FGameSerializerReferenceTable& operator=( const FGameSerializerReferenceTable& other );
+
+	FGameSerializerReferenceTable( FGameSerializerReferenceTable&& ) = default;
+	FGameSerializerReferenceTable& operator=( FGameSerializerReferenceTable&& ) = default;
+
+	UPROPERTY( VisibleAnywhere, SaveGame, Category = Serializer )
+		TArray< FName > Names;
+
+	UPROPERTY( VisibleAnywhere, SaveGame, Category = Serializer )
+		TArray< FString > ObjectPaths;
+
+	int32 AddName( FName name );
+
+	int32 AddObject( UObject* object );
+
+	FName GetName( int32 index ) const { return Names.IsValidIndex( index ) ? Names[index] : NAME_None; }
+
+	/** Finds the object for an entry. Found objects are remembered, entries that didn't resolve are looked up again next time. */
+	UObject* ResolveObject( int32 index );
+
+	bool IsEmpty() const { return Names.Num() == 0 && ObjectPaths.Num() == 0; }
+
+	/** Same entries at the same indices, blobs indexing into either table read the same. */
+	bool Matches( const FGameSerializerReferenceTable& other ) const { return Names == other.Names && ObjectPaths == other.ObjectPaths; }
+
+	void Reset();
+
+	/** Heap memory held by the table, lookups included. */
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	/** Lookups are rebuilt lazily after the table was loaded from disk. */
+	void BuildLookups();
+
+	TMap< FName, int32 > NameLookup;
+
+	TMap< FObjectKey, int32 > ObjectLookup;
+
+	TMap< FString, int32 > PathLookup;
+
+	TArray< TWeakObjectPtr< UObject > > ResolvedObjects;
+};
+
+/**
+ * Save game archive that writes names and object references as packed indices into a FGameSerializerReferenceTable.
+ */
+struct GAMESERIALIZER_API FGameSerializerTableArchive : public FArchiveProxy
+{
+	FGameSerializerTableArchive( FArchive& innerArchive, FGameSerializerReferenceTable& table )
+		:FArchiveProxy( innerArchive ),
+		Table( table )
+	{
+		ArIsSaveGame = true;
+	}
+
+	virtual FArchive& operator<<( FName& N ) override;
+	virtual FArchive& operator<<( UObject*& Obj ) override;
+	virtual FArchive& operator<<( FWeakObjectPtr& Obj ) override;
+	virtual FArchive& operator<<( FSoftObjectPtr& Value ) override;
+	virtual FArchive& operator<<( FSoftObjectPath& Value ) override;
+	virtual FArchive& operator<<( FObjectPtr& Obj ) override;
+
+	virtual FString GetArchiveName() const override { return TEXT( "FGameSerializerTableArchive" ); }
+
+private:
+
+	FGameSerializerReferenceTable& Table;
+};
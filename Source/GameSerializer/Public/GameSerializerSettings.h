@@ -8,6 +8,46 @@
 
 #include "GameSerializerSettings.generated.h"
 
+class AActor;
+
+UENUM()
+enum class EGameSerializerReferenceMode : uint8
+{
+	/** Every name and object reference is written as a string inside each blob. */
+	Strings,
+
+	/** Names and object paths are written once per world into a reference table, blobs only hold indices. */
+	ReferenceTable,
+};
+
+UENUM()
+enum class EGameSerializerCompression : uint8
+{
+	/** Sections go to disk as they are. */
+	None,
+
+	Zlib,
+
+	LZ4,
+
+	/** Falls back to Zlib on builds without Oodle. */
+	Oodle,
+};
+
+/** How an actor's transform is stored when its world is written, see FGameSerializerTransformCodec. */
+UENUM(BlueprintType)
+enum class EGameSerializerTransformCodec : uint8
+{
+	/** Double precision, exactly what was captured. */
+	Full,
+
+	/** Single precision, the location relative to the world's origin. */
+	Float,
+
+	/** Location in steps of TransformQuantizationStep from the world's origin, rotation as the smallest three components in 16 bits each. */
+	Quantized,
+};
+
 /**
  * 
  */
@@ -27,4 +67,130 @@ public:
 
 	UPROPERTY( config, EditAnywhere, Category = Serialization )
 		bool bAutoLoadGameOnBeginPlay;
+
+	UPROPERTY( config, EditAnywhere, Category = Serialization )
+		EGameSerializerReferenceMode ReferenceMode;
+
+	/**
+	 * Serialize objects through a per-class schema of their SaveGame properties instead of the full UObject::Serialize walk.
+	 * Schema blobs are untagged, changing a class's SaveGame properties makes its existing blobs unreadable.
+	 * Native Serialize overrides are bypassed, list classes that write extra state there in TaggedEncodingClasses.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Serialization )
+		bool bUseCompiledSchemas;
+
+	/**
+	 * With compiled schemas, only store the SaveGame properties that differ from the archetype: the class defaults for spawned actors
+	 * and objects, the state a placed actor had when its level came in for the rest. Loading resets everything else to the archetype.
+	 * With compiled schemas on, a placed actor's state in the level is snapshotted whenever it differs from its class defaults, which costs
+	 * memory per actor. That happens with this off too, a save written with it on still needs the snapshots to load.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Serialization, meta = ( EditCondition = "bUseCompiledSchemas" ) )
+		bool bDeltaEncoding;
+
+	/**
+	 * Classes, and their subclasses, that keep using UObject::Serialize with compiled schemas on.
+	 * Needed for classes whose native Serialize override saves state that isn't in a SaveGame property, the schema would lose it.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Serialization, meta = ( EditCondition = "bUseCompiledSchemas" ) )
+		TArray< TSoftClassPtr< UObject > > TaggedEncodingClasses;
+
+	/**
+	 * Reuse an actor's blob from the previous capture when it wasn't marked dirty and hasn't moved.
+	 * Only enable this if game code calls MarkActorDirty whenever SaveGame state changes.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Serialization )
+		bool bIncrementalCapture;
+
+	/**
+	 * Milliseconds per frame a serialization manager may spend spawning and loading actors when its level comes in.
+	 * Closest actors to the player are restored first. 0 restores the whole world in BeginPlay.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Loading, meta = ( ClampMin = "0", Units = "ms" ) )
+		float RestoreBudgetMs;
+
+	/** Milliseconds per frame an amortized save (SaveGameToSlotAmortized) may spend capturing actors. */
+	UPROPERTY( config, EditAnywhere, Category = Saving, meta = ( ClampMin = "0", Units = "ms" ) )
+		float CaptureBudgetMs;
+
+	/** Serialize and write save files on a worker thread, so only the world capture happens on the game thread. */
+	UPROPERTY( config, EditAnywhere, Category = Saving )
+		bool bWriteSavesAsync;
+
+	/** How save file sections are compressed. Slots written with any format stay readable whatever this is set to later. */
+	UPROPERTY( config, EditAnywhere, Category = Saving )
+		EGameSerializerCompression Compression;
+
+	/** Sections are compressed in blocks of this size, blocks compress and decompress in parallel. */
+	UPROPERTY( config, EditAnywhere, Category = Saving, meta = ( ClampMin = "16", Units = "KB" ) )
+		int32 CompressionBlockSizeKB;
+
+	/**
+	 * Between checkpoints, saves only append what changed to a journal next to the slot, loads replay it over the checkpoint.
+	 * Works with incremental captures to turn frequent saves into small writes. Slots that aren't plain files are always written whole.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Saving )
+		bool bJournalSaves;
+
+	/** A save that would grow a slot's journal past this writes a new checkpoint instead. */
+	UPROPERTY( config, EditAnywhere, Category = Saving, meta = ( EditCondition = "bJournalSaves", ClampMin = "64", Units = "KB" ) )
+		int32 JournalCompactionKB;
+
+	/** A save that would grow a slot's journal past this share of the checkpoint's size writes a new checkpoint instead. */
+	UPROPERTY( config, EditAnywhere, Category = Saving, meta = ( EditCondition = "bJournalSaves", ClampMin = "0.05" ) )
+		float JournalCompactionRatio;
+
+	/** How actor transforms are written when neither a tag nor a class below picks a codec. */
+	UPROPERTY( config, EditAnywhere, Category = Saving )
+		EGameSerializerTransformCodec DefaultTransformCodec;
+
+	/** Transform codecs for actors of these classes and their subclasses, the closest class wins. */
+	UPROPERTY( config, EditAnywhere, Category = Saving )
+		TMap< TSoftClassPtr< AActor >, EGameSerializerTransformCodec > TransformCodecsByClass;
+
+	/** Transform codecs for actors with these tags, tags win over classes. */
+	UPROPERTY( config, EditAnywhere, Category = Saving )
+		TMap< FName, EGameSerializerTransformCodec > TransformCodecsByTag;
+
+	/** Step quantized locations are rounded to, it's stored with each world so changing it keeps old saves readable. */
+	UPROPERTY( config, EditAnywhere, Category = Saving, meta = ( ClampMin = "0.001", Units = "cm" ) )
+		float TransformQuantizationStep;
+
+	/** Lets the UGameAutosaveScheduler save on an interval. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave )
+		bool bAutosave;
+
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( EditCondition = "bAutosave", ClampMin = "10", Units = "s" ) )
+		float AutosaveIntervalSeconds;
+
+	/** No autosave starts sooner than this after any save, manual ones and requested autosaves included. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( ClampMin = "0", Units = "s" ) )
+		float AutosaveMinSpacingSeconds;
+
+	/** Slot autosaves go to, -1 for the slot the game was loaded from or last saved to. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( ClampMin = "-1" ) )
+		int32 AutosaveSlot;
+
+	/** Spread the autosave's capture over frames with CaptureBudgetMs, see SaveGameToSlotAmortized. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave )
+		bool bAmortizeAutosave;
+
+	/** Game thread time a frame is meant to take, waiting on vsync and the frame rate limit left out. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( ClampMin = "1", Units = "ms" ) )
+		float AutosaveFrameBudgetMs;
+
+	/**
+	 * Room an autosave needs left in the frame budget, at least. The capture's own cost is used when it's bigger:
+	 * CaptureBudgetMs for amortized autosaves, what the last one took otherwise. Never more than half of AutosaveFrameBudgetMs.
+	 */
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( ClampMin = "0", Units = "ms" ) )
+		float AutosaveHeadroomMs;
+
+	/** Consecutive frames, the current one included, that have to leave that room before an autosave starts. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( ClampMin = "1" ) )
+		int32 AutosaveCheapFrames;
+
+	/** An autosave that waited this long for cheap frames starts on a busy one, 0 to wait as long as it takes. Blocks still hold it. */
+	UPROPERTY( config, EditAnywhere, Category = Autosave, meta = ( ClampMin = "0", Units = "s" ) )
+		float AutosaveMaxDeferralSeconds;
 };
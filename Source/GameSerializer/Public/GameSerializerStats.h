@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/** Everything the serializer spends time on, shown with "stat GameSerializer". */
+DECLARE_STATS_GROUP( TEXT( "GameSerializer" ), STATGROUP_GameSerializer, STATCAT_Advanced );
+
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Gather World States" ), STAT_GameSerializer_Gather, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Capture World" ), STAT_GameSerializer_CaptureWorld, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Serialize Actor" ), STAT_GameSerializer_SerializeActor, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Serialize Object" ), STAT_GameSerializer_SerializeObject, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Write Save" ), STAT_GameSerializer_WriteSave, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Load Save" ), STAT_GameSerializer_LoadSave, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Encode World" ), STAT_GameSerializer_EncodeWorld, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Decode World" ), STAT_GameSerializer_DecodeWorld, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Restore World" ), STAT_GameSerializer_RestoreWorld, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Load Actor" ), STAT_GameSerializer_LoadActor, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Load Object" ), STAT_GameSerializer_LoadObject, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Spawn Actor" ), STAT_GameSerializer_SpawnActor, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "PostDataLoaded" ), STAT_GameSerializer_PostDataLoaded, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Actors Serialized (last save)" ), STAT_GameSerializer_ActorsSerialized, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Actors Reused (last save)" ), STAT_GameSerializer_ActorsReused, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Actors Sharing a Blob (last save)" ), STAT_GameSerializer_ActorsShared, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_FLOAT_COUNTER_STAT_EXTERN( TEXT( "Blob Dedup Ratio (last save)" ), STAT_GameSerializer_DedupRatio, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+DECLARE_MEMORY_STAT_EXTERN( TEXT( "Save File Size (last save)" ), STAT_GameSerializer_SaveBytes, STATGROUP_GameSerializer, GAMESERIALIZER_API );
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN( GAMESERIALIZER_API, GameSerializer );
+
+/** Low level memory tracker tags, everything under GameSerializer in "stat LLMFULL" and LLM captures. */
+LLM_DECLARE_TAG_API( GameSerializer, GAMESERIALIZER_API );
+
+/** World captures and the save snapshots taken from them. */
+LLM_DECLARE_TAG_API( GameSerializer_Capture, GAMESERIALIZER_API );
+
+/** Save files being written or read, slot headers and the manifest. */
+LLM_DECLARE_TAG_API( GameSerializer_SaveFile, GAMESERIALIZER_API );
+
+/** Worlds of levels out of play, encoded and decoded, and prefetches. */
+LLM_DECLARE_TAG_API( GameSerializer_WorldState, GAMESERIALIZER_API );
+
+/** Applying a world to its level, actors spawned by the restore included. */
+LLM_DECLARE_TAG_API( GameSerializer_Restore, GAMESERIALIZER_API );
+
+/**
+ * Insights scope with a name built at runtime, e.g. tagged with a world id or class.
+ * The name is only formatted while the cpu channel is being traced, so it costs nothing otherwise.
+ * Expands to a single declaration, like the engine's scope macros.
+ */
+#if CPUPROFILERTRACE_ENABLED
+	/** What GAMESERIALIZER_TRACE_SCOPE declares, the event only exists if the channel was on when the scope was entered. */
+	class FGameSerializerTraceScope
+	{
+	public:
+
+		template< typename NameFunctionType >
+		FGameSerializerTraceScope( bool bEnabled, NameFunctionType&& nameFunction )
+		{
+			if ( bEnabled )
+			{
+				Scope.Emplace( *nameFunction(), CpuChannel );
+			}
+		}
+
+	private:
+
+		TOptional< FCpuProfilerTrace::FDynamicEventScope > Scope;
+	};
+
+	#define GAMESERIALIZER_TRACE_SCOPE( Format, ... ) \
+		FGameSerializerTraceScope PREPROCESSOR_JOIN( GameSerializerTraceScope, __LINE__ )( UE_TRACE_CHANNELEXPR_IS_ENABLED( CpuChannel ), [&]() { return FString::Printf( Format, ##__VA_ARGS__ ); } )
+#else
+	#define GAMESERIALIZER_TRACE_SCOPE( Format, ... )
+#endif
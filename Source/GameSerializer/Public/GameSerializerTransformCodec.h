@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "Classes.h"
+
+/**
+ * Writes the transforms of a world's actors as one packed block after the world's arena, instead of a tagged FTransform in every record.
+ * Transforms are split by codec into flat arrays of locations, rotations and scales, and each array is converted in a single pass.
+ * Identity scales are left out whatever the codec. The arrays go through the archive element by element, in its byte order.
+ */
+class GAMESERIALIZER_API FGameSerializerTransformCodec
+{
+public:
+
+	/**
+	 * The codec the settings give an actor: by its tags first, then by its class or the closest super class that has one, then the default.
+	 * classCache remembers what classes resolved to between calls.
+	 */
+	static EGameSerializerTransformCodec Resolve( const AActor* actor, TMap< TObjectKey< UClass >, EGameSerializerTransformCodec >& classCache );
+
+	/**
+	 * Whether two transforms are the same within what the codec keeps of them.
+	 * quantizationStep is the step a quantized transform was decoded with, the settings' step is used if it's 0.
+	 */
+	static bool Matches( const FTransform& a, const FTransform& b, EGameSerializerTransformCodec codec, double quantizationStep = 0.0 );
+
+	/** Writes the transform of every actor of the world, in the order the world's actors iterate in. */
+	static void Encode( const FSerializedWorld& world, FArchive& Ar );
+
+	/**
+	 * Reads a block written by Encode into a world that was just decoded from the same bytes, its actors iterate in the order they were written.
+	 * Reads nothing and returns true if there's no block at the reader's position, false if the block doesn't fit the world.
+	 */
+	static bool Decode( FArchive& Ar, FSerializedWorld& world );
+};
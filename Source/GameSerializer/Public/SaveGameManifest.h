@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "SaveGameManifest.generated.h"
+
+class USavedGameState;
+
+/**
+ * Header of a single save slot, everything a slot list needs without touching the slot's payload.
+ */
+USTRUCT(BlueprintType)
+struct GAMESERIALIZER_API FGameSaveSlotInfo
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int32 SlotIndex = INDEX_NONE;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		FString SlotName;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		FDateTime TimeOfSave;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		FString SavedTime;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		FString SavedMap;
+
+	/** Size of the slot file on disk. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int64 FileSize = 0;
+
+	/** What the slot's sections add up to before compression, FileSize if it isn't compressed. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int64 UncompressedSize = 0;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int32 ScreenshotSizeX = 0;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int32 ScreenshotSizeY = 0;
+
+	/** Byte offset of the thumbnail pixels within the slot file, INDEX_NONE if the slot format doesn't expose it or they're compressed. */
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int64 ThumbnailOffset = INDEX_NONE;
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Save )
+		int64 ThumbnailSize = 0;
+
+	/** Fills the header fields from a fully loaded save. */
+	void CopyFromSave( const USavedGameState* save );
+
+	/** Fills a header only save object, used for slot lists. */
+	void ApplyToSave( USavedGameState* save ) const;
+
+	friend FArchive& operator<<( FArchive& Ar, FGameSaveSlotInfo& info );
+};
+
+/**
+ * Index of every slot under a save prefix, stored as its own tiny slot so listing saves is a single small read.
+ * Kept in memory by the UGameSaveManager and rewritten whenever a slot is written.
+ */
+struct GAMESERIALIZER_API FGameSaveManifest
+{
+	static FString GetManifestSlotName( const FString& prefix ) { return prefix + TEXT( "manifest" ); }
+
+	/** Reads the manifest for a prefix, returns false if there is none or it's unreadable. */
+	bool Load( const FString& prefix );
+
+	bool Save( const FString& prefix ) const;
+
+	const FGameSaveSlotInfo* Find( int32 slotIndex ) const;
+
+	void Update( const FGameSaveSlotInfo& info );
+
+	void Reset();
+
+	/** Sorted by slot index. */
+	TArray< FGameSaveSlotInfo > Slots;
+
+	bool bLoaded = false;
+};
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+
+#include "SerializableIdentityComponent.generated.h"
+
+/**
+ * Gives an actor a stable 64 bit id for save data, independent of its name or path.
+ * Placed actors get theirs when they are created in the editor, spawned actors when they spawn,
+ * and actors respawned from a save get their saved id back.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class GAMESERIALIZER_API USerializableIdentityComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	USerializableIdentityComponent();
+
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Category = Serializer )
+		int64 PersistentId;
+
+	virtual void OnComponentCreated() override;
+
+	virtual void PostDuplicate( EDuplicateMode::Type DuplicateMode ) override;
+
+#if WITH_EDITOR
+	virtual void PostEditImport() override;
+#endif
+
+	/** Returns a new random non zero id. */
+	static int64 GenerateId();
+
+private:
+
+	void EnsureId();
+};
@@ -10,6 +10,8 @@
 
 #include "SerializationHelpers.generated.h"
 
+class FGameSerializerSnapshot;
+
 /**
  * 
  */
@@ -28,13 +30,49 @@ public:
 		static FSerializedGameObject SaveObject( UObject* object );
 
 	UFUNCTION(BlueprintCallable, Category = "Game Serializer")
-		static void LoadActor(AActor* actor, FSerializedActor save);
+		static void LoadActor(AActor* actor, const FSerializedActor& save);
 
 	UFUNCTION( BlueprintCallable, Category = "Game Serializer" )
 		static void LoadObject( UObject* object, FSerializedGameObject save );
 
+	/** Loads an actor's record straight from the world it was captured in, whether its blob is in the arena or not. */
+	UFUNCTION( BlueprintCallable, Category = "Game Serializer" )
+		static bool LoadActorFromWorld( AActor* actor, UPARAM( ref ) FSerializedWorld& world, int64 actorId );
+
+	/** Writes names and object references into the given table, or as strings if it's null. */
+	static FSerializedActor SaveActor( AActor* actor, FGameSerializerReferenceTable* references );
+
+	static FSerializedGameObject SaveObject( UObject* object, FGameSerializerReferenceTable* references );
+
+	/**
+	 * Appends the actor's blob to a world's arena instead of giving it its own allocation.
+	 * Delta blobs are taken against the archetype snapshot if there is one, it has to be given again on load.
+	 * Without it, the properties the blob left out keep whatever value the actor has.
+	 */
+	static FSerializedActor SaveActor( AActor* actor, FGameSerializerReferenceTable* references, TArray< uint8 >& arena, const FGameSerializerSnapshot* archetype = nullptr );
+
+	/** The table has to be the one the save was written with if it uses one. Records whose blob lives in an arena need their world, see FSerializedWorld::DetachActor. */
+	static void LoadActor( AActor* actor, const FSerializedActor& save, FGameSerializerReferenceTable* references );
+
+	/** Loads a record of a world with that world's blob and reference table. */
+	static bool LoadActor( AActor* actor, const FSerializedActor& save, FSerializedWorld& world, const FGameSerializerSnapshot* archetype = nullptr, bool bNotify = true );
+
+	/**
+	 * Loads from a blob that lives elsewhere, usually FSerializedWorld::GetActorData. Returns false if nothing was loaded.
+	 * Without bNotify the caller fires PostDataLoaded through NotifyDataLoaded itself, for actors that haven't begun play yet.
+	 */
+	static bool LoadActor( AActor* actor, const FSerializedActor& save, TArrayView< const uint8 > data, FGameSerializerReferenceTable* references, const FGameSerializerSnapshot* archetype = nullptr, bool bNotify = true );
+
+	/** Fires IGameSerializable::PostDataLoaded if the object implements it. */
+	static void NotifyDataLoaded( UObject* object );
+
+	static void LoadObject( UObject* object, const FSerializedGameObject& save, FGameSerializerReferenceTable* references );
+
+	/** The table blobs should be written with under the current settings, null when writing names as strings. */
+	static FGameSerializerReferenceTable* GetReferenceTable( FGameSerializerReferenceTable& table );
+
 	UFUNCTION(BlueprintCallable, Category = "Game Serializer", meta = ( WorldContext = "WorldContextObject" ) )
-		static AActor* SpawnAndLoadActor(UObject* WorldContextObject, FSerializedActor save);
+		static AActor* SpawnAndLoadActor(UObject* WorldContextObject, const FSerializedActor& save);
 
 	UFUNCTION( BlueprintCallable, Category = "Game Serializer" )
 		static void SerializeGameWorld() {}
@@ -45,6 +83,31 @@ public:
 	UFUNCTION( BlueprintPure, Category = "Game Serializer" )
 		static FName ResolveID( UObject* object );
 
+	/**
+	 * Stable id of an actor within its level. Uses the actor's USerializableIdentityComponent if it has one,
+	 * otherwise a hash of its path relative to the level.
+	 */
+	UFUNCTION( BlueprintPure, Category = "Game Serializer" )
+		static int64 ResolveActorID( AActor* actor );
+
+	/** Gives an actor respawned from a save its saved id back, attaching an identity component if it has none. Same timing as EnsureActorID. */
+	static void AssignActorID( AActor* actor, int64 id );
+
+	/**
+	 * Attaches an identity component to a spawned actor that has none. Their names aren't stable between sessions,
+	 * so without one the path hash would give them a different id every time they're respawned.
+	 * Call it once the construction script ran, or a component the class adds there ends up next to this one.
+	 */
+	static void EnsureActorID( AActor* actor );
+
+	/** Call right before changing or destroying a saved actor, keeps amortized captures consistent. */
+	UFUNCTION( BlueprintCallable, Category = "Game Serializer" )
+		static void PreModifyActor( AActor* actor );
+
+	/** Call after changing an actor's SaveGame state so incremental captures pick it up. */
+	UFUNCTION( BlueprintCallable, Category = "Game Serializer" )
+		static void MarkActorDirty( AActor* actor );
+
 	UFUNCTION( BlueprintPure, Category = "Game Serializer" )
 		static bool IsClassBlacklisted( TSubclassOf< UObject > objectClass );
 
@@ -8,6 +8,8 @@
 #include "GameFramework/Info.h"
 #include "SerializationManager.generated.h"
 
+class FGameSerializerSnapshot;
+
 
 UCLASS( ClassGroup=(Custom)/*, meta=(BlueprintSpawnableComponent)*/ )
 class GAMESERIALIZER_API ASerializationManager : public AInfo
@@ -29,21 +31,99 @@ public:
 	UPROPERTY( EditAnywhere, BlueprintReadOnly )
 		TSoftObjectPtr< class UWorld > WorldRef;
 
+	/**
+	 * The world's save data, owned by the manager while its level is in play and handed back to the save manager in EndPlay.
+	 * Empty while a save snapshot shares the last capture, GetWorldData sees it either way.
+	 */
 	UPROPERTY( VisibleAnywhere, BlueprintReadOnly )
 		FSerializedWorld WorldData;
 
+	UPROPERTY( VisibleAnywhere, BlueprintReadOnly, Transient )
+		FGameSerializerCaptureStats LastCaptureStats;
+
 	UFUNCTION( BlueprintCallable, Category = Serialization )
 	FSerializedWorld CacheWorldState()
 	{
 		CacheWorld();
-		return WorldData;
+		return GetWorldData();
 	}
 
-	virtual void LoadWorldState( FSerializedWorld state );
+	/** The world's save data, whether it's in WorldData or shared with a save snapshot. */
+	const FSerializedWorld& GetWorldData() const { return SharedWorldData.IsValid() ? *SharedWorldData : WorldData; }
+
+	/** Hands the last capture to a save snapshot read only instead of copying it. The next capture takes it back, copying only if the snapshot is still alive. */
+	FSharedWorldPtr ShareWorldState();
+
+	/** Applies a world's save data, spread over several frames if the settings give a restore budget. */
+	virtual void LoadWorldState( FSerializedWorld&& state );
+
+	/** Drops the world's data without giving it back, for when a newer game state is taking over. */
+	void ReleaseWorldState();
+
+	/** False once the world's data was released, the level then isn't part of any save anymore. */
+	bool OwnsWorldState() const { return !bWorldStateReleased; }
+
+	/** Captures every serializable actor of the level into WorldData right away. */
+	virtual void CacheWorld();
+
+	/** True while actors are still waiting to be restored. */
+	UFUNCTION( BlueprintPure, Category = Serialization )
+		bool IsRestoring() const { return PendingRestores.Num() > 0; }
+
+	/** Fired once every actor of the world has been restored. */
+	UPROPERTY( BlueprintAssignable, Category = Serialization )
+		FWorldRestoredEvent OnWorldRestored;
+
+	virtual void Tick( float DeltaSeconds ) override;
+
+	/**
+	 * Starts a capture that can be spread over several frames with StepCapture.
+	 * The actors registered right now are what gets captured, later spawns wait for the next capture.
+	 */
+	void BeginCapture();
+
+	/** Captures queued actors until the budget runs out, a budget of 0 or less captures all of them. Returns true once nothing is left. */
+	bool StepCapture( double budgetSeconds );
+
+	/** Hands the captured world to the save manager. */
+	void FinishCapture();
+
+	bool IsCapturing() const { return bCapturing; }
+
+	/**
+	 * Captures an actor that's still waiting in the current capture right away, so the capture sees it as it was when the capture started.
+	 * Called before an actor changes or gets destroyed mid capture.
+	 */
+	void CaptureActorNow( AActor* actor );
+
+	/** Adds an actor of this manager's level to the registry if it can be serialized at all. */
+	void RegisterActor( AActor* actor );
+
+	void UnregisterActor( AActor* actor );
+
+	/** Only actors implementing IGameSerializable are ever captured, everything else stays out of the registry. */
+	static bool IsSerializableActor( const AActor* actor );
+
+	/** Serializable actors in this manager's level, captures and loads only ever look at these. */
+	const TSet< TWeakObjectPtr< AActor > >& GetSerializableActors() const { return SerializableActors; }
+
+	/** What a placed actor's delta blobs are taken against, null for spawned actors and ones that came in with their class defaults. */
+	const FGameSerializerSnapshot* GetArchetype( const AActor* actor ) const;
+
+	/**
+	 * Heap memory held for the world: its data, the previous capture, the spare arena, the capture and restore queues and the archetype snapshots.
+	 * A capture shared with save snapshots is skipped if countedBuffers already saw it.
+	 */
+	SIZE_T GetWorldAllocatedSize( TSet< const void* >* countedBuffers = nullptr ) const;
+
+	virtual void GetResourceSizeEx( FResourceSizeEx& CumulativeResourceSize ) override;
 
 
 protected:
 
+	/** Takes the archetype snapshots, the level's actors are all loaded by now and none of them began play. */
+	virtual void PostInitializeComponents() override;
+
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
@@ -53,7 +133,107 @@ protected:
 
 	virtual void PreDelete( AActor* actor, EEndPlayReason::Type EndPlayReason );
 
-	virtual void CacheWorld();
+	/** Fills the registry from the level's actor list, done once when the level comes in. */
+	void BuildActorRegistry();
+
+	/** Snapshots the placed serializable actors of the level that differ from their class defaults. */
+	void TakeArchetypes();
+
+	TSet< TWeakObjectPtr< AActor > > SerializableActors;
+
+	/**
+	 * State of placed actors when the level came in, kept while it differs from the class defaults.
+	 * Taken whenever compiled schemas are on, a save with delta blobs can be loaded whether or not delta encoding is on now.
+	 */
+	TMap< TObjectKey< AActor >, TSharedPtr< FGameSerializerSnapshot > > Archetypes;
+
+	struct FPendingRestore
+	{
+		int64 Id = 0;
+
+		/** The existing actor to load into, spawns a new one if null. */
+		TWeakObjectPtr< AActor > Actor;
+
+		bool bSpawn = false;
+
+		double Priority = 0.0;
+	};
+
+	/** Restores queued actors until the budget runs out, a budget of 0 or less restores all of them. */
+	void ProcessRestores( double budgetSeconds );
+
+	void RestoreActor( const FPendingRestore& pending );
+
+	void FinishRestore();
+
+	/** Fires PostDataLoaded on an actor that was loaded into, once it has begun play. */
+	void NotifyDataLoaded( AActor* actor );
+
+	void FlushDataLoaded();
+
+	/** Loaded actors waiting for their BeginPlay before they hear about it. */
+	TArray< TWeakObjectPtr< AActor > > PendingDataLoaded;
+
+	FTimerHandle DataLoadedTimer;
+
+	TArray< FPendingRestore > PendingRestores;
+
+	int32 RestoreCursor = 0;
+
+	void CaptureActor( AActor* actor );
+
+	/** Actors of the running capture, entries are cleared as they get captured. */
+	TArray< TWeakObjectPtr< AActor > > CaptureQueue;
+
+	TMap< TObjectKey< AActor >, int32 > CaptureQueueIndex;
+
+	int32 CaptureCursor = 0;
+
+	/** The last capture while save snapshots share it, WorldData is empty meanwhile. */
+	TSharedPtr< FSerializedWorld, ESPMode::ThreadSafe > SharedWorldData;
+
+	/** Moves a shared capture back into WorldData before anything changes it. */
+	void ReclaimWorldState();
+
+	/** The last complete capture, unchanged actors move their blob over from here. */
+	FSerializedWorld PreviousWorldData;
+
+	/** Arena of the capture before last, kept so the next capture doesn't have to grow a new one. */
+	TArray< uint8 > SpareArena;
+
+	/** Transform codecs the settings gave actor classes during the running capture. */
+	TMap< TObjectKey< UClass >, EGameSerializerTransformCodec > TransformCodecs;
+
+	/** Arena offset of every distinct blob of the running capture, by fingerprint and size. */
+	TMap< uint64, int32 > ArenaSpans;
+
+	/**
+	 * Points an actor whose blob was just appended to the arena at an identical blob that's already there, and drops the copy.
+	 * Blobs index into the world's reference table, so they're only ever shared within a world. Returns true if it was shared.
+	 */
+	bool ShareArenaSpan( FSerializedActor& actor );
+
+	bool bCapturing = false;
+
+	bool bIncrementalCapture = false;
+
+	/** The capture started from the previous one's reference table, because of incremental reuse or carried records. */
+	bool bKeepReferences = false;
+
+	/** Actors still waiting to be restored when the level left play, their records were copied into the capture unchanged. */
+	TSet< int64 > CarriedActors;
+
+	/** Set in EndPlay, the last capture mustn't spawn or load anything. */
+	bool bEndingPlay = false;
+
+	/** Entries in the world's reference table after the last full capture, incremental ones only ever add to it. */
+	int32 FullCaptureReferenceCount = 0;
+
+	/** Set once a capture came out different from the world the level was loaded with. */
+	bool bWorldDirty = false;
+
+	/** Set by ReleaseWorldState, EndPlay then has nothing to hand back. */
+	bool bWorldStateReleased = false;
 
 public:	
 
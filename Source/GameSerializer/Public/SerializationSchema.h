@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/StrongObjectPtr.h"
+
+/** One step of a compiled schema, either a single SaveGame property or a run of plain old data copied as is. */
+struct FGameSerializerSchemaEntry
+{
+	/** Null for raw runs. */
+	FProperty* Property = nullptr;
+
+	int32 Offset = 0;
+
+	/** Bytes covered by a raw run. */
+	int32 Size = 0;
+};
+
+/** A single SaveGame property as delta blobs address it, by its index in the schema. */
+struct FGameSerializerSchemaProperty
+{
+	FProperty* Property = nullptr;
+
+	/** Where the value sits in a FGameSerializerSnapshot, INDEX_NONE for properties holding object references, snapshots don't keep those. */
+	int32 SnapshotOffset = INDEX_NONE;
+};
+
+class FGameSerializerSnapshot;
+
+/**
+ * The SaveGame properties of a class, collected once so every instance skips the reflection walk.
+ * Adjacent plain old data properties are merged into raw runs and copied in one go.
+ *
+ * The output is untagged, so it's only readable by a schema with the same hash. Raw runs are written in native byte order.
+ * The object's own Serialize is never called, classes that save extra state in a native override need tagged encoding.
+ */
+class GAMESERIALIZER_API FGameSerializerClassSchema
+{
+public:
+
+	/** Returns the cached schema for a class, building it on first use or after the class layout changed. */
+	static TSharedRef< const FGameSerializerClassSchema > Get( const UClass* objectClass );
+
+	/** Drops every cached schema, called on hot reload and Blueprint reinstancing. */
+	static void InvalidateAll();
+
+	static void RegisterInvalidationHooks();
+
+	static void UnregisterInvalidationHooks();
+
+	/** Saves or loads the schema's properties of an instance of the class. */
+	void Serialize( FArchive& Ar, UObject* object ) const;
+
+	/**
+	 * Saves or loads only the properties whose value differs from the archetype's, each as its index followed by the value.
+	 * The archetype is the class default object unless a snapshot is given, properties the snapshot doesn't keep are always saved.
+	 * The blob notes which of the two it was taken against. Loading puts every property it leaves out back to that archetype's value,
+	 * unless it needs a snapshot and the one given is missing or out of date, those properties are left alone then.
+	 * Returns false if the blob is corrupt.
+	 */
+	bool SerializeDelta( FArchive& Ar, UObject* object, const FGameSerializerSnapshot* snapshot ) const;
+
+	/** Identifies the property layout, stored in front of every schema blob. */
+	uint32 GetHash() const { return Hash; }
+
+	int32 NumProperties() const { return PropertyCount; }
+
+	const TArray< FGameSerializerSchemaEntry >& GetEntries() const { return Entries; }
+
+	const TArray< FGameSerializerSchemaProperty >& GetProperties() const { return Properties; }
+
+private:
+
+	friend class FGameSerializerSnapshot;
+
+	explicit FGameSerializerClassSchema( const UClass* objectClass );
+
+	bool IsUpToDate( const UClass* objectClass ) const;
+
+	/** Whether a property can be copied as raw bytes and still match what tagged serialization would restore. */
+	static bool IsPlainData( const FProperty* property );
+
+	/** The archetype's value of a property, null if it has to be saved regardless. */
+	const void* GetArchetypeValue( int32 index, const UObject* defaults, const FGameSerializerSnapshot* snapshot ) const;
+
+	TArray< FGameSerializerSchemaEntry > Entries;
+
+	TArray< FGameSerializerSchemaProperty > Properties;
+
+	/** Bytes and alignment a snapshot of the class needs. */
+	int32 SnapshotSize = 0;
+
+	int32 SnapshotAlignment = 1;
+
+	uint32 Hash = 0;
+
+	int32 PropertyCount = 0;
+
+	/** Used to spot layout changes the invalidation hooks didn't catch. */
+	const FProperty* FirstProperty = nullptr;
+
+	int32 PropertiesSize = 0;
+
+	static TMap< FObjectKey, TSharedRef< const FGameSerializerClassSchema > > Cache;
+
+	static FCriticalSection CacheLock;
+
+	static FDelegateHandle ReloadHandle;
+
+	static FDelegateHandle ReplacedHandle;
+};
+
+/**
+ * The SaveGame values of an object as they were at some point, the archetype delta blobs of a level's placed actors are taken against,
+ * since the state authored in the level is gone once the game changed it. Holds everything but properties with object references.
+ */
+class GAMESERIALIZER_API FGameSerializerSnapshot
+{
+public:
+
+	UE_NONCOPYABLE( FGameSerializerSnapshot );
+
+	/** Snapshots the object, null if it doesn't differ from its class default object, which is the archetype then. */
+	static TSharedPtr< FGameSerializerSnapshot > Take( const UObject* object );
+
+	~FGameSerializerSnapshot();
+
+	/** Whether the snapshot still fits the class's current schema. */
+	bool IsValidFor( const FGameSerializerClassSchema& schema ) const { return &schema == &Schema.Get(); }
+
+	/** The snapshot's value of a schema property, null if it doesn't keep that one. */
+	const void* GetValue( int32 index ) const;
+
+	SIZE_T GetAllocatedSize() const { return Schema->SnapshotSize; }
+
+private:
+
+	FGameSerializerSnapshot( const TSharedRef< const FGameSerializerClassSchema >& schema, const UClass* objectClass );
+
+	TSharedRef< const FGameSerializerClassSchema > Schema;
+
+	/** The properties belong to the class, it's kept around until the values are destroyed. Only held on the game thread. */
+	TStrongObjectPtr< UClass > Class;
+
+	uint8* Data = nullptr;
+};
@@ -0,0 +1,742 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameSerializerBenchmarkCommandlet.h"
+
+#include "GameSerializerBenchmarkTypes.h"
+#include "GameSerializerSettings.h"
+#include "SerializationManager.h"
+#include "Classes.h"
+#include "GameSaveJournal.h"
+
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/MemoryBase.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+#include <atomic>
+
+DEFINE_LOG_CATEGORY_STATIC( LogSaveGameBenchmark, Log, All );
+
+namespace SaveBenchmark
+{
+	/** Set while the proxy does its own bookkeeping, whose allocations come back through it and mustn't be counted. */
+	static thread_local bool bInsideCounter = false;
+
+	/**
+	 * Forwards to the real allocator and counts what goes through it while a phase is being measured, on every thread.
+	 * Only installed as GMalloc for the length of a phase. It lives until exit, threads may still be inside it after it's uninstalled.
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+
+		/** Puts the proxy in front of the current GMalloc and starts counting. */
+		void Begin()
+		{
+			check( !bCounting );
+
+			Inner = GMalloc;
+			Allocations = 0;
+			AllocatedBytes = 0;
+			LiveBytes = 0;
+			PeakLiveBytes = 0;
+			bCounting = true;
+			GMalloc = this;
+		}
+
+		/** Hands GMalloc back and forgets the blocks of the phase. */
+		void End()
+		{
+			GMalloc = Inner;
+			bCounting = false;
+
+			FScopeLock lock( &LiveLock );
+			LiveBlocks.Empty();
+		}
+
+		int64 GetAllocations() const { return Allocations; }
+
+		int64 GetAllocatedBytes() const { return AllocatedBytes; }
+
+		/** Most bytes the phase's own allocations held at once. */
+		int64 GetPeakBytes() const { return PeakLiveBytes; }
+
+		virtual void* Malloc( SIZE_T count, uint32 alignment ) override
+		{
+			void* result = Inner->Malloc( count, alignment );
+			OnAllocated( result, count );
+			return result;
+		}
+
+		virtual void* TryMalloc( SIZE_T count, uint32 alignment ) override
+		{
+			void* result = Inner->TryMalloc( count, alignment );
+			OnAllocated( result, count );
+			return result;
+		}
+
+		virtual void* Realloc( void* original, SIZE_T count, uint32 alignment ) override
+		{
+			OnFreed( original );
+			void* result = Inner->Realloc( original, count, alignment );
+			OnAllocated( result, count );
+			return result;
+		}
+
+		virtual void* TryRealloc( void* original, SIZE_T count, uint32 alignment ) override
+		{
+			OnFreed( original );
+			void* result = Inner->TryRealloc( original, count, alignment );
+			OnAllocated( result, count );
+			return result;
+		}
+
+		virtual void Free( void* original ) override
+		{
+			OnFreed( original );
+			Inner->Free( original );
+		}
+
+		virtual bool GetAllocationSize( void* original, SIZE_T& outSize ) override { return Inner->GetAllocationSize( original, outSize ); }
+		virtual SIZE_T QuantizeSize( SIZE_T count, uint32 alignment ) override { return Inner->QuantizeSize( count, alignment ); }
+		virtual void Trim( bool bTrimThreadCaches ) override { Inner->Trim( bTrimThreadCaches ); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats( FGenericMemoryStats& outStats ) override { Inner->GetAllocatorStats( outStats ); }
+		virtual void DumpAllocatorStats( FOutputDevice& Ar ) override { Inner->DumpAllocatorStats( Ar ); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+	private:
+
+		void OnAllocated( void* result, SIZE_T requested )
+		{
+			if ( !result || !bCounting || bInsideCounter )
+			{
+				return;
+			}
+
+			SIZE_T size = requested;
+			Inner->GetAllocationSize( result, size );
+
+			Allocations++;
+			AllocatedBytes += size;
+
+			TGuardValue< bool > guard( bInsideCounter, true );
+			FScopeLock lock( &LiveLock );
+
+			LiveBlocks.Add( result, size );
+			LiveBytes += size;
+			PeakLiveBytes = FMath::Max( PeakLiveBytes, LiveBytes );
+		}
+
+		/** Only blocks allocated inside the phase count against its live bytes, older ones are freed without a trace. */
+		void OnFreed( void* original )
+		{
+			if ( !original || !bCounting || bInsideCounter )
+			{
+				return;
+			}
+
+			TGuardValue< bool > guard( bInsideCounter, true );
+			FScopeLock lock( &LiveLock );
+
+			SIZE_T size = 0;
+
+			if ( LiveBlocks.RemoveAndCopyValue( original, size ) )
+			{
+				LiveBytes -= size;
+			}
+		}
+
+		FMalloc* Inner = nullptr;
+
+		std::atomic< bool > bCounting { false };
+		std::atomic< int64 > Allocations { 0 };
+		std::atomic< int64 > AllocatedBytes { 0 };
+
+		FCriticalSection LiveLock;
+
+		/** Blocks allocated since Begin and not freed yet, with their size. */
+		TMap< void*, SIZE_T > LiveBlocks;
+
+		int64 LiveBytes = 0;
+		int64 PeakLiveBytes = 0;
+	};
+
+	struct FSample
+	{
+		double Seconds = 0.0;
+		int64 Allocations = 0;
+		int64 AllocatedBytes = 0;
+		int64 PeakBytes = 0;
+
+		/** What the phase produced or consumed: captured blobs, the slot file, the world data applied. */
+		int64 Bytes = 0;
+	};
+
+	struct FPhase
+	{
+		FString Name;
+		TArray< FSample > Samples;
+
+		double GetMedianMs() const
+		{
+			TArray< double > times;
+
+			for ( const FSample& sample : Samples )
+			{
+				times.Add( sample.Seconds * 1000.0 );
+			}
+
+			times.Sort();
+			return times.Num() > 0 ? times[times.Num() / 2] : 0.0;
+		}
+
+		TSharedRef< FJsonObject > ToJson() const
+		{
+			double minMs = TNumericLimits< double >::Max();
+			double maxMs = 0.0;
+			int64 allocations = 0;
+			int64 allocatedBytes = 0;
+			int64 peakBytes = 0;
+			int64 bytes = 0;
+
+			for ( const FSample& sample : Samples )
+			{
+				minMs = FMath::Min( minMs, sample.Seconds * 1000.0 );
+				maxMs = FMath::Max( maxMs, sample.Seconds * 1000.0 );
+				allocations += sample.Allocations;
+				allocatedBytes += sample.AllocatedBytes;
+				peakBytes = FMath::Max( peakBytes, sample.PeakBytes );
+				bytes = sample.Bytes;
+			}
+
+			const int32 count = FMath::Max( Samples.Num(), 1 );
+
+			TSharedRef< FJsonObject > json = MakeShared< FJsonObject >();
+			json->SetStringField( TEXT( "Name" ), Name );
+			json->SetNumberField( TEXT( "MedianMs" ), GetMedianMs() );
+			json->SetNumberField( TEXT( "MinMs" ), Samples.Num() > 0 ? minMs : 0.0 );
+			json->SetNumberField( TEXT( "MaxMs" ), maxMs );
+			json->SetNumberField( TEXT( "Allocations" ), (double)( allocations / count ) );
+			json->SetNumberField( TEXT( "AllocatedBytes" ), (double)( allocatedBytes / count ) );
+			json->SetNumberField( TEXT( "PeakBytes" ), (double)peakBytes );
+			json->SetNumberField( TEXT( "Bytes" ), (double)bytes );
+			return json;
+		}
+	};
+
+	struct FConfig
+	{
+		int32 Actors = 500;
+		int32 Properties = 8;
+		float SpawnedRatio = 0.5f;
+		int32 Sublevels = 4;
+		int32 Objects = 32;
+		float DirtyRatio = 1.0f;
+		int32 Iterations = 5;
+	};
+
+	struct FSublevel
+	{
+		UWorld* World = nullptr;
+		ASerializationManager* Manager = nullptr;
+	};
+
+	static FCountingMalloc& GetCountingMalloc()
+	{
+		static FCountingMalloc counting;
+		return counting;
+	}
+
+	/** Runs body once while timing it and counting its allocations, body returns the bytes it dealt with. */
+	template< typename FunctionType >
+	static FSample Measure( FunctionType&& body )
+	{
+		FSample sample;
+		FCountingMalloc& counting = GetCountingMalloc();
+
+		counting.Begin();
+		const double start = FPlatformTime::Seconds();
+
+		sample.Bytes = body();
+
+		sample.Seconds = FPlatformTime::Seconds() - start;
+		counting.End();
+
+		sample.Allocations = counting.GetAllocations();
+		sample.AllocatedBytes = counting.GetAllocatedBytes();
+		sample.PeakBytes = counting.GetPeakBytes();
+		return sample;
+	}
+
+	static int64 GetWorldBytes( const FSerializedWorld& world )
+	{
+		int64 bytes = world.ActorArena.Num();
+
+		for ( auto&& keypair : world.Actors )
+		{
+			bytes += keypair.Value.Data.Num();
+		}
+
+		return bytes;
+	}
+
+	/** A world standing in for one streamed in sublevel, with its own serialization manager. */
+	static FSublevel CreateSublevel( UGameInstance* gameInstance, int32 index, const FConfig& config )
+	{
+		FSublevel sublevel;
+
+		const FName worldId = FName( TEXT( "GameSerializerBenchmark" ), index + 1 );
+
+		// Initialized only once it knows its game instance, so the save manager hooks its spawns
+		sublevel.World = UWorld::CreateWorld( EWorldType::Game, false, worldId, nullptr, true, ERHIFeatureLevel::Num, nullptr, true );
+		sublevel.World->SetGameInstance( gameInstance );
+
+		FWorldContext& context = GEngine->CreateNewWorldContext( EWorldType::Game );
+		context.OwningGameInstance = gameInstance;
+		context.SetCurrentWorld( sublevel.World );
+
+		sublevel.World->InitWorld( UWorld::InitializationValues()
+			.AllowAudioPlayback( false )
+			.CreatePhysicsScene( false )
+			.RequiresHitProxies( false )
+			.CreateNavigation( false )
+			.CreateAISystem( false )
+			.ShouldSimulatePhysics( false )
+			.SetTransactional( false ) );
+
+		sublevel.World->InitializeActorsForPlay( FURL() );
+
+		const int32 spawned = FMath::RoundToInt( config.Actors * FMath::Clamp( config.SpawnedRatio, 0.0f, 1.0f ) );
+		AGameSerializerBenchmarkActor* previous = nullptr;
+
+		for ( int32 x = 0; x < config.Actors; x++ )
+		{
+			const FVector location( ( x % 100 ) * 200.0f, ( x / 100 ) * 200.0f, index * 1000.0f );
+			AGameSerializerBenchmarkActor* actor = sublevel.World->SpawnActor< AGameSerializerBenchmarkActor >( location, FRotator::ZeroRotator );
+
+			if ( !actor )
+			{
+				continue;
+			}
+
+			actor->Randomize( index * config.Actors + x, config.Properties );
+			actor->Neighbour = previous;
+
+			// Placed actors are the ones the level loaded with
+			actor->bNetStartup = x >= spawned;
+
+			previous = actor;
+		}
+
+		sublevel.Manager = sublevel.World->SpawnActorDeferred< ASerializationManager >( ASerializationManager::StaticClass(), FTransform::Identity );
+		sublevel.Manager->WorldID = worldId;
+		sublevel.Manager->FinishSpawning( FTransform::Identity );
+
+		// No game mode to start play, the manager builds its registry from the actors spawned above
+		sublevel.World->GetWorldSettings()->NotifyBeginPlay();
+
+		return sublevel;
+	}
+
+	static void DestroySublevel( FSublevel& sublevel )
+	{
+		// Nothing should be cached back into the save manager on the way out
+		if ( IsValid( sublevel.Manager ) )
+		{
+			sublevel.Manager->ReleaseWorldState();
+		}
+
+		GEngine->DestroyWorldContext( sublevel.World );
+		sublevel.World->DestroyWorld( false );
+		sublevel.World->RemoveFromRoot();
+		sublevel = FSublevel();
+	}
+
+	/** Changes a share of every world's actors the way gameplay would, and flags them for incremental captures. */
+	static void MutateWorlds( UGameSaveManager* saveManager, TArray< FSublevel >& sublevels, const TArray< UGameSerializerBenchmarkObject* >& objects, float dirtyRatio, int32 iteration )
+	{
+		FRandomStream random( iteration );
+
+		for ( FSublevel& sublevel : sublevels )
+		{
+			for ( const TWeakObjectPtr< AActor >& weakActor : sublevel.Manager->GetSerializableActors() )
+			{
+				AGameSerializerBenchmarkActor* actor = Cast< AGameSerializerBenchmarkActor >( weakActor.Get() );
+
+				if ( actor && random.GetFraction() < dirtyRatio )
+				{
+					actor->Counter++;
+					actor->Health = random.FRandRange( 0.0f, 100.0f );
+					saveManager->MarkActorDirty( actor );
+				}
+			}
+		}
+
+		for ( UGameSerializerBenchmarkObject* object : objects )
+		{
+			object->Counter++;
+		}
+	}
+
+	static void WaitForSave( TFuture< bool >& future )
+	{
+		// The write finishes on the game thread, which is us
+		while ( !future.IsReady() )
+		{
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle( ENamedThreads::GameThread );
+			FPlatformProcess::Sleep( 0.0f );
+		}
+	}
+
+	static int64 GetSlotFileSize( UGameSaveManager* saveManager, int32 slot )
+	{
+		for ( const FGameSaveSlotInfo& info : saveManager->GetSaveSlots() )
+		{
+			if ( info.SlotIndex == slot )
+			{
+				return info.FileSize;
+			}
+		}
+
+		return 0;
+	}
+
+	static TSharedRef< FJsonObject > DescribeSettings( const UGameSerializerSettings* settings )
+	{
+		TSharedRef< FJsonObject > json = MakeShared< FJsonObject >();
+		json->SetStringField( TEXT( "ReferenceMode" ), StaticEnum< EGameSerializerReferenceMode >()->GetNameStringByValue( (int64)settings->ReferenceMode ) );
+		json->SetBoolField( TEXT( "bUseCompiledSchemas" ), settings->bUseCompiledSchemas );
+		json->SetBoolField( TEXT( "bDeltaEncoding" ), settings->bDeltaEncoding );
+		json->SetStringField( TEXT( "DefaultTransformCodec" ), StaticEnum< EGameSerializerTransformCodec >()->GetNameStringByValue( (int64)settings->DefaultTransformCodec ) );
+		json->SetBoolField( TEXT( "bIncrementalCapture" ), settings->bIncrementalCapture );
+		json->SetBoolField( TEXT( "bWriteSavesAsync" ), settings->bWriteSavesAsync );
+		json->SetStringField( TEXT( "Compression" ), StaticEnum< EGameSerializerCompression >()->GetNameStringByValue( (int64)settings->Compression ) );
+		json->SetNumberField( TEXT( "CompressionBlockSizeKB" ), settings->CompressionBlockSizeKB );
+		return json;
+	}
+
+	/** Logs how every phase moved against a previous report, false if one regressed past maxRegression percent. */
+	static bool CompareWithBaseline( const FString& path, const TArray< FPhase >& phases, float maxRegression )
+	{
+		FString text;
+		TSharedPtr< FJsonObject > baseline;
+
+		if ( !FFileHelper::LoadFileToString( text, *path ) || !FJsonSerializer::Deserialize( TJsonReaderFactory<>::Create( text ), baseline ) || !baseline.IsValid() )
+		{
+			UE_LOG( LogSaveGameBenchmark, Error, TEXT( "Couldn't read benchmark baseline %s" ), *path );
+			return false;
+		}
+
+		TMap< FString, TSharedPtr< FJsonObject > > baselinePhases;
+		const TArray< TSharedPtr< FJsonValue > >* entries = nullptr;
+
+		if ( baseline->TryGetArrayField( TEXT( "Phases" ), entries ) )
+		{
+			for ( const TSharedPtr< FJsonValue >& entry : *entries )
+			{
+				const TSharedPtr< FJsonObject >* phase = nullptr;
+
+				if ( entry.IsValid() && entry->TryGetObject( phase ) )
+				{
+					baselinePhases.Add( ( *phase )->GetStringField( TEXT( "Name" ) ), *phase );
+				}
+			}
+		}
+
+		bool bPassed = true;
+
+		UE_LOG( LogSaveGameBenchmark, Display, TEXT( "Against baseline %s:" ), *path );
+
+		for ( const FPhase& phase : phases )
+		{
+			const TSharedPtr< FJsonObject >* found = baselinePhases.Find( phase.Name );
+
+			if ( !found )
+			{
+				UE_LOG( LogSaveGameBenchmark, Display, TEXT( "  %-18s not in baseline" ), *phase.Name );
+				continue;
+			}
+
+			const TSharedRef< FJsonObject > current = phase.ToJson();
+
+			const double baseMs = ( *found )->GetNumberField( TEXT( "MedianMs" ) );
+			const double baseAllocations = ( *found )->GetNumberField( TEXT( "Allocations" ) );
+			const double timeDelta = baseMs > 0.0 ? ( current->GetNumberField( TEXT( "MedianMs" ) ) - baseMs ) / baseMs * 100.0 : 0.0;
+			const double allocationDelta = baseAllocations > 0.0 ? ( current->GetNumberField( TEXT( "Allocations" ) ) - baseAllocations ) / baseAllocations * 100.0 : 0.0;
+
+			const bool bRegressed = maxRegression > 0.0f && timeDelta > maxRegression;
+			bPassed &= !bRegressed;
+
+			UE_LOG( LogSaveGameBenchmark, Display, TEXT( "  %-18s time %+7.1f%%  allocations %+7.1f%%%s" ), *phase.Name, timeDelta, allocationDelta, bRegressed ? TEXT( "  REGRESSED" ) : TEXT( "" ) );
+		}
+
+		return bPassed;
+	}
+}
+
+UGameSerializerBenchmarkCommandlet::UGameSerializerBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	LogToConsole = true;
+
+	HelpDescription = TEXT( "Times CacheWorld, SaveGameToSlot, LoadGameFromSlot and ASerializationManager::LoadWorldState on synthetic worlds." );
+	HelpUsage = TEXT( "-run=GameSerializerBenchmark [-Actors=N] [-Properties=M] [-SpawnedRatio=F] [-Sublevels=K] [-Objects=P] [-DirtyRatio=F] [-Iterations=I] [-Output=Path] [-Baseline=Path] [-MaxRegression=Pct]" );
+}
+
+int32 UGameSerializerBenchmarkCommandlet::Main( const FString& Params )
+{
+	using namespace SaveBenchmark;
+
+	FConfig config;
+	FParse::Value( *Params, TEXT( "Actors=" ), config.Actors );
+	FParse::Value( *Params, TEXT( "Properties=" ), config.Properties );
+	FParse::Value( *Params, TEXT( "SpawnedRatio=" ), config.SpawnedRatio );
+	FParse::Value( *Params, TEXT( "Sublevels=" ), config.Sublevels );
+	FParse::Value( *Params, TEXT( "Objects=" ), config.Objects );
+	FParse::Value( *Params, TEXT( "DirtyRatio=" ), config.DirtyRatio );
+	FParse::Value( *Params, TEXT( "Iterations=" ), config.Iterations );
+
+	config.Sublevels = FMath::Max( config.Sublevels, 1 );
+	config.Iterations = FMath::Max( config.Iterations, 1 );
+
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT( "Benchmarks" ) / FString::Printf( TEXT( "GameSerializer-%s.json" ), *FDateTime::Now().ToString() );
+	FParse::Value( *Params, TEXT( "Output=" ), outputPath );
+
+	FString baselinePath;
+	FParse::Value( *Params, TEXT( "Baseline=" ), baselinePath );
+
+	float maxRegression = 0.0f;
+	FParse::Value( *Params, TEXT( "MaxRegression=" ), maxRegression );
+
+	// Restores have to finish inside the phase that starts them, and nothing may load a real slot
+	UGameSerializerSettings* settings = UGameSerializerSettings::Get();
+	const bool bAutoLoad = settings->bAutoLoadGameOnBeginPlay;
+	const float restoreBudget = settings->RestoreBudgetMs;
+	settings->bAutoLoadGameOnBeginPlay = false;
+	settings->RestoreBudgetMs = 0.0f;
+
+	UGameInstance* gameInstance = NewObject< UGameInstance >( GEngine );
+	gameInstance->AddToRoot();
+	gameInstance->InitializeStandalone( TEXT( "GameSerializerBenchmark" ) );
+
+	UGameSaveManager* saveManager = gameInstance->GetSubsystem< UGameSaveManager >();
+	saveManager->AssignSavePrefix( TEXT( "benchmark_" ) );
+
+	const int32 slot = 0;
+
+	TArray< FSublevel > sublevels;
+
+	for ( int32 x = 0; x < config.Sublevels; x++ )
+	{
+		sublevels.Add( CreateSublevel( gameInstance, x, config ) );
+	}
+
+	TArray< UGameSerializerBenchmarkObject* > objects;
+
+	for ( int32 x = 0; x < config.Objects; x++ )
+	{
+		UGameSerializerBenchmarkObject* object = NewObject< UGameSerializerBenchmarkObject >( GetTransientPackage(), FName( TEXT( "GameSerializerBenchmarkObject" ), x + 1 ) );
+		object->Notes = FString::Printf( TEXT( "Persistent object %i" ), x );
+		object->Values.SetNum( 64 );
+		objects.Add( object );
+
+		saveManager->CachePersistentObject( object );
+	}
+
+	UE_LOG( LogSaveGameBenchmark, Display, TEXT( "Benchmarking %i sublevels of %i actors with %i entries, %i persistent objects, %i iterations" ), config.Sublevels, config.Actors, config.Properties, config.Objects, config.Iterations );
+
+	TArray< FPhase > phases;
+	phases.AddDefaulted( 4 );
+	phases[0].Name = TEXT( "CacheWorld" );
+	phases[1].Name = TEXT( "SaveGameToSlot" );
+	phases[2].Name = TEXT( "LoadGameFromSlot" );
+	phases[3].Name = TEXT( "LoadWorldState" );
+
+	bool bSucceeded = true;
+
+	// The first run only warms up caches, schemas and the slot file
+	for ( int32 iteration = 0; iteration <= config.Iterations && bSucceeded; iteration++ )
+	{
+		const bool bMeasured = iteration > 0;
+
+		MutateWorlds( saveManager, sublevels, objects, config.DirtyRatio, iteration );
+
+		const FSample capture = Measure( [&]()
+		{
+			saveManager->CacheWorld();
+
+			int64 bytes = 0;
+
+			for ( const FSublevel& sublevel : sublevels )
+			{
+				bytes += GetWorldBytes( sublevel.Manager->GetWorldData() );
+			}
+
+			for ( auto&& keypair : saveManager->CurrentGameState.PersistentObjects )
+			{
+				bytes += keypair.Value.Data.Num();
+			}
+
+			return bytes;
+		} );
+
+		const FSample save = Measure( [&]()
+		{
+			TFuture< bool > future = saveManager->SaveGameToSlotAsync( slot );
+			WaitForSave( future );
+
+			bSucceeded &= future.Get();
+			return GetSlotFileSize( saveManager, slot );
+		} );
+
+		const FSample load = Measure( [&]()
+		{
+			saveManager->LoadGameFromSlot( slot, false );
+			return GetSlotFileSize( saveManager, slot );
+		} );
+
+		// Spawned actors go away first so the restore has to spawn them again, like a level coming back in
+		TArray< FSerializedWorld > worlds;
+
+		for ( FSublevel& sublevel : sublevels )
+		{
+			worlds.Add( sublevel.Manager->GetWorldData() );
+
+			for ( const TWeakObjectPtr< AActor >& weakActor : sublevel.Manager->GetSerializableActors().Array() )
+			{
+				AActor* actor = weakActor.Get();
+
+				if ( actor && !actor->bNetStartup )
+				{
+					sublevel.World->DestroyActor( actor );
+				}
+			}
+		}
+
+		const FSample restore = Measure( [&]()
+		{
+			int64 bytes = 0;
+
+			for ( int32 x = 0; x < sublevels.Num(); x++ )
+			{
+				bytes += GetWorldBytes( worlds[x] );
+				sublevels[x].Manager->LoadWorldState( MoveTemp( worlds[x] ) );
+			}
+
+			return bytes;
+		} );
+
+		if ( bMeasured )
+		{
+			phases[0].Samples.Add( capture );
+			phases[1].Samples.Add( save );
+			phases[2].Samples.Add( load );
+			phases[3].Samples.Add( restore );
+		}
+
+		CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+	}
+
+	if ( !bSucceeded )
+	{
+		UE_LOG( LogSaveGameBenchmark, Error, TEXT( "Benchmark save failed, no report written" ) );
+	}
+
+	TSharedRef< FJsonObject > report = MakeShared< FJsonObject >();
+
+	TSharedRef< FJsonObject > configJson = MakeShared< FJsonObject >();
+	configJson->SetNumberField( TEXT( "Actors" ), config.Actors );
+	configJson->SetNumberField( TEXT( "Properties" ), config.Properties );
+	configJson->SetNumberField( TEXT( "SpawnedRatio" ), config.SpawnedRatio );
+	configJson->SetNumberField( TEXT( "Sublevels" ), config.Sublevels );
+	configJson->SetNumberField( TEXT( "Objects" ), config.Objects );
+	configJson->SetNumberField( TEXT( "DirtyRatio" ), config.DirtyRatio );
+	configJson->SetNumberField( TEXT( "Iterations" ), config.Iterations );
+
+	report->SetObjectField( TEXT( "Config" ), configJson );
+	report->SetObjectField( TEXT( "Settings" ), DescribeSettings( settings ) );
+	report->SetStringField( TEXT( "Time" ), FDateTime::UtcNow().ToIso8601() );
+
+	TArray< TSharedPtr< FJsonValue > > phasesJson;
+
+	UE_LOG( LogSaveGameBenchmark, Display, TEXT( "%-18s %10s %10s %12s %14s %14s %12s" ), TEXT( "Phase" ), TEXT( "MedianMs" ), TEXT( "MaxMs" ), TEXT( "Allocations" ), TEXT( "AllocBytes" ), TEXT( "PeakBytes" ), TEXT( "Bytes" ) );
+
+	for ( const FPhase& phase : phases )
+	{
+		const TSharedRef< FJsonObject > json = phase.ToJson();
+		phasesJson.Add( MakeShared< FJsonValueObject >( json ) );
+
+		UE_LOG( LogSaveGameBenchmark, Display, TEXT( "%-18s %10.2f %10.2f %12.0f %14.0f %14.0f %12.0f" ), *phase.Name,
+			json->GetNumberField( TEXT( "MedianMs" ) ), json->GetNumberField( TEXT( "MaxMs" ) ), json->GetNumberField( TEXT( "Allocations" ) ),
+			json->GetNumberField( TEXT( "AllocatedBytes" ) ), json->GetNumberField( TEXT( "PeakBytes" ) ), json->GetNumberField( TEXT( "Bytes" ) ) );
+	}
+
+	report->SetArrayField( TEXT( "Phases" ), phasesJson );
+
+	if ( bSucceeded )
+	{
+		FString text;
+		FJsonSerializer::Serialize( report, TJsonWriterFactory<>::Create( &text ) );
+
+		if ( FFileHelper::SaveStringToFile( text, *outputPath ) )
+		{
+			UE_LOG( LogSaveGameBenchmark, Display, TEXT( "Wrote benchmark report %s" ), *outputPath );
+		}
+		else
+		{
+			UE_LOG( LogSaveGameBenchmark, Error, TEXT( "Couldn't write benchmark report %s" ), *outputPath );
+		}
+
+		if ( !baselinePath.IsEmpty() )
+		{
+			bSucceeded = CompareWithBaseline( baselinePath, phases, maxRegression );
+		}
+	}
+
+	for ( FSublevel& sublevel : sublevels )
+	{
+		DestroySublevel( sublevel );
+	}
+
+	UGameplayStatics::DeleteGameInSlot( saveManager->GetIndexedSaveName( slot ), 0 );
+	FGameSaveJournal::Delete( saveManager->GetIndexedSaveName( slot ) );
+	UGameplayStatics::DeleteGameInSlot( FGameSaveManifest::GetManifestSlotName( saveManager->SavePrefix ), 0 );
+
+	for ( UGameSerializerBenchmarkObject* object : objects )
+	{
+		saveManager->ReleasePersistentObject( object );
+	}
+
+	UWorld* world = gameInstance->GetWorld();
+	gameInstance->Shutdown();
+
+	if ( world )
+	{
+		GEngine->DestroyWorldContext( world );
+		world->DestroyWorld( false );
+	}
+
+	gameInstance->RemoveFromRoot();
+
+	settings->bAutoLoadGameOnBeginPlay = bAutoLoad;
+	settings->RestoreBudgetMs = restoreBudget;
+
+	return bSucceeded ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GameSerializerBenchmarkTypes.h"
+
+#include "Classes.h"
+#include "SerializableIdentityComponent.h"
+#include "Components/SceneComponent.h"
+
+AGameSerializerBenchmarkActor::AGameSerializerBenchmarkActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Captures skip actors with a static root
+	RootComponent = CreateDefaultSubobject< USceneComponent >( TEXT( "Root" ) );
+	RootComponent->SetMobility( EComponentMobility::Movable );
+
+	CreateDefaultSubobject< USerializableIdentityComponent >( TEXT( "Identity" ) );
+
+	Tags.Add( SaveTags::Save );
+
+	Counter = 0;
+	Health = 100.0f;
+	Neighbour = nullptr;
+}
+
+void AGameSerializerBenchmarkActor::Randomize( int32 seed, int32 entryCount )
+{
+	FRandomStream random( seed );
+
+	Counter = random.RandRange( 0, 1 << 20 );
+	Health = random.FRandRange( 0.0f, 100.0f );
+	Description = FString::Printf( TEXT( "Benchmark actor %i" ), seed );
+
+	Entries.SetNum( entryCount );
+
+	for ( int32 x = 0; x < entryCount; x++ )
+	{
+		FGameSerializerBenchmarkEntry& entry = Entries[x];
+		entry.Value = random.RandRange( 0, 1 << 16 );
+		entry.Weight = random.GetFraction();
+		entry.Label = FName( TEXT( "Entry" ), x % 16 );
+		entry.Offset = random.GetUnitVector() * random.FRandRange( 0.0f, 1000.0f );
+	}
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "GameSerializerBenchmarkCommandlet.generated.h"
+
+/**
+ * Times the save and load pipeline on synthetic worlds, runs headless:
+ *
+ *   UnrealEditor-Cmd <Project> -run=GameSerializerBenchmark -nullrhi -unattended
+ *
+ * Options:
+ *   -Actors=N          saved actors per sublevel (500)
+ *   -Properties=M      FGameSerializerBenchmarkEntry blocks per actor, 4 SaveGame properties each (8)
+ *   -SpawnedRatio=F    share of actors that count as spawned rather than placed (0.5)
+ *   -Sublevels=K       worlds, each with its own ASerializationManager (4)
+ *   -Objects=P         persistent objects (32)
+ *   -DirtyRatio=F      share of actors changed and marked dirty before each capture (1.0)
+ *   -Iterations=I      measured runs of every phase (5), after one warm up run
+ *   -Output=Path       JSON report, Saved/Benchmarks/GameSerializer-<time>.json by default
+ *   -Baseline=Path     a previous report to compare against
+ *   -MaxRegression=Pct fail when a phase's median time regresses more than this against the baseline
+ *
+ * Every phase reports wall time, allocations, bytes allocated, peak live heap and the bytes it produced or consumed.
+ */
+UCLASS()
+class GAMESERIALIZERBENCHMARK_API UGameSerializerBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UGameSerializerBenchmarkCommandlet();
+
+	virtual int32 Main( const FString& Params ) override;
+};
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "IGameSerializable.h"
+
+#include "GameSerializerBenchmarkTypes.generated.h"
+
+/** One block of SaveGame properties, benchmark actors carry as many of these as the run asks for. */
+USTRUCT()
+struct FGameSerializerBenchmarkEntry
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY( SaveGame )
+		int32 Value = 0;
+
+	UPROPERTY( SaveGame )
+		float Weight = 0.0f;
+
+	UPROPERTY( SaveGame )
+		FName Label;
+
+	UPROPERTY( SaveGame )
+		FVector Offset = FVector::ZeroVector;
+};
+
+/** Synthetic saved actor the benchmark commandlet fills its worlds with. */
+UCLASS( NotBlueprintable, NotPlaceable )
+class GAMESERIALIZERBENCHMARK_API AGameSerializerBenchmarkActor : public AActor, public IGameSerializable
+{
+	GENERATED_BODY()
+
+public:
+
+	AGameSerializerBenchmarkActor();
+
+	UPROPERTY( SaveGame )
+		int32 Counter;
+
+	UPROPERTY( SaveGame )
+		float Health;
+
+	UPROPERTY( SaveGame )
+		FString Description;
+
+	/** Another actor of the same world, so blobs carry object references. */
+	UPROPERTY( SaveGame )
+		AActor* Neighbour;
+
+	UPROPERTY( SaveGame )
+		TArray< FGameSerializerBenchmarkEntry > Entries;
+
+	/** Fills the SaveGame properties with values derived from seed, entryCount entries of FGameSerializerBenchmarkEntry. */
+	void Randomize( int32 seed, int32 entryCount );
+
+protected:
+
+	virtual void DataLoaded() override {}
+};
+
+/** Synthetic persistent object for the benchmark commandlet. */
+UCLASS( NotBlueprintable )
+class GAMESERIALIZERBENCHMARK_API UGameSerializerBenchmarkObject : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY( SaveGame )
+		int32 Counter = 0;
+
+	UPROPERTY( SaveGame )
+		FString Notes;
+
+	UPROPERTY( SaveGame )
+		TArray< int32 > Values;
+};